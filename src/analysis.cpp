@@ -0,0 +1,403 @@
+#include "analysis.hpp"
+#include "scheduler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <thread>
+
+namespace {
+constexpr double maxScale = 1e6;
+constexpr double scalePrecision = 1e-4;
+constexpr long maxPeriodSearch = 1L << 40;
+constexpr std::chrono::seconds maxConfirmHorizon{60};
+
+constexpr long maxCandidates = 512;
+constexpr std::size_t maxArrivals = 1 << 24;
+
+double relative(const AnalysisTask &t) {
+  return t.deadline > 0 ? std::min(t.deadline, t.period) : t.period;
+}
+
+// Work of the jobs that arrive from 0 on and are due by time, with
+// deadlines moved earlier by the jitter.
+double demand(std::span<const AnalysisTask> taskSet, double time) {
+  double work = 0;
+  for (const AnalysisTask &t : taskSet) {
+    double due = relative(t) - t.jitter;
+    if (time >= due) {
+      work += (std::floor((time - due) / t.period + 1e-12) + 1) * t.duration;
+    }
+  }
+  return work;
+}
+
+// Latest deadline strictly before time, or 0 if there is none.
+double deadlineBefore(std::span<const AnalysisTask> taskSet, double time) {
+  double latest = 0;
+  for (const AnalysisTask &t : taskSet) {
+    double due = relative(t) - t.jitter;
+    if (due < time) {
+      double k = std::ceil((time - due) / t.period - 1e-12) - 1;
+      latest = std::max(latest, due + k * t.period);
+    }
+  }
+  return latest;
+}
+
+// Checks demand(t) <= t at every deadline up to the first point the
+// demand could overflow, walking down from there as QPA (Zhang and Burns)
+// does. At full utilization the walk starts at the hyperperiod, which
+// needs integral periods.
+bool edfFeasible(std::span<const AnalysisTask> taskSet) {
+  double utilization = 0;
+  double slack = 0;
+  double earliest = std::numeric_limits<double>::max();
+  double latest = 0;
+  bool implicit = true;
+  long long hyperperiod = 1;
+  for (const AnalysisTask &t : taskSet) {
+    double due = relative(t) - t.jitter;
+    utilization += t.duration / t.period;
+    slack += (t.period - due) * t.duration / t.period;
+    earliest = std::min(earliest, due);
+    latest = std::max(latest, due);
+    implicit = implicit && due >= t.period;
+    if (hyperperiod > 0 && t.period == std::floor(t.period) &&
+        t.period <= maxPeriodSearch) {
+      hyperperiod = std::lcm(hyperperiod, static_cast<long long>(t.period));
+      hyperperiod = hyperperiod > maxPeriodSearch ? 0 : hyperperiod;
+    } else {
+      hyperperiod = 0;
+    }
+  }
+  if (utilization > 1 + 1e-12) {
+    return false;
+  }
+  if (implicit) {
+    return true;
+  }
+  if (earliest <= 0) {
+    return false;
+  }
+  double bound;
+  if (utilization < 1 - 1e-12) {
+    bound = std::max(latest, slack / (1 - utilization));
+  } else if (hyperperiod > 0) {
+    bound = static_cast<double>(hyperperiod) + latest;
+  } else {
+    return false;
+  }
+  double time = deadlineBefore(taskSet, bound + 1e-9);
+  double work = demand(taskSet, time);
+  while (work <= time + 1e-9 && work > earliest + 1e-9) {
+    time = work < time - 1e-9 ? work : deadlineBefore(taskSet, time);
+    work = demand(taskSet, time);
+  }
+  return work <= earliest + 1e-9;
+}
+
+// Response-time analysis with the tasks taking priority in order of key,
+// lowest first.
+template <typename Key>
+bool fixedPriorityFeasible(std::span<const AnalysisTask> taskSet, Key key) {
+  std::vector<std::size_t> order(taskSet.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::ranges::stable_sort(order, {}, [&taskSet, &key](std::size_t i) {
+    return key(taskSet[i]);
+  });
+  for (std::size_t k = 0; k < order.size(); k++) {
+    const AnalysisTask &t = taskSet[order[k]];
+    double response = t.duration;
+    while (true) {
+      double next = t.duration;
+      for (std::size_t j = 0; j < k; j++) {
+        const AnalysisTask &hp = taskSet[order[j]];
+        next += std::ceil((response + hp.jitter) / hp.period - 1e-12) *
+                hp.duration;
+      }
+      if (next + t.jitter > relative(t) + 1e-9) {
+        return false;
+      }
+      if (next <= response) {
+        break;
+      }
+      response = next;
+    }
+  }
+  return true;
+}
+
+// Largest x in [0, maxScale] with fits(x), assuming fits is monotone.
+double searchScale(const std::function<bool(double)> &fits) {
+  if (!fits(0)) {
+    return 0;
+  }
+  double low = 0, high = 1;
+  while (fits(high)) {
+    low = high;
+    high *= 2;
+    if (high > maxScale) {
+      return maxScale;
+    }
+  }
+  while (high - low > scalePrecision * std::max(low, 1.0)) {
+    double mid = (low + high) / 2;
+    (fits(mid) ? low : high) = mid;
+  }
+  return low;
+}
+
+// Smallest whole period in [floor, maxPeriodSearch] with fits(period).
+// Fixed priorities change where the period crosses another task's, so fits
+// is only assumed monotone between consecutive starts; each of those
+// intervals is searched on its own, lowest first.
+long searchPeriod(long floor, std::vector<long> starts,
+                  const std::function<bool(long)> &fits) {
+  floor = std::max(floor, 1L);
+  std::erase_if(starts, [floor](long start) { return start <= floor; });
+  starts.push_back(floor);
+  std::ranges::sort(starts);
+  starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+  for (std::size_t k = 0; k < starts.size(); k++) {
+    long low = starts[k] - 1;
+    long high;
+    if (k + 1 < starts.size()) {
+      high = starts[k + 1] - 1;
+      if (!fits(high)) {
+        continue;
+      }
+    } else {
+      high = starts[k];
+      while (!fits(high)) {
+        low = high;
+        high *= 2;
+        if (high > maxPeriodSearch) {
+          return -1;
+        }
+      }
+    }
+    while (high - low > 1) {
+      long mid = low + (high - low) / 2;
+      (fits(mid) ? high : low) = mid;
+    }
+    return high;
+  }
+  return -1;
+}
+
+// Runs jobs(0..count-1) on every core.
+void fanOut(std::size_t count, const std::function<void(std::size_t)> &job) {
+  std::atomic<std::size_t> next{0};
+  unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::jthread> pool;
+  for (unsigned w = 0; w < std::min<std::size_t>(workers, count); w++) {
+    pool.emplace_back([&]() {
+      for (std::size_t i = next++; i < count; i = next++) {
+        job(i);
+      }
+    });
+  }
+}
+
+bool confirm(std::span<const TaskParams> taskSet, SchedulingAlgo algo,
+             double scale) {
+  long long horizon = 1;
+  long settle = 0;
+  std::vector<TaskParams> scaled;
+  scaled.reserve(taskSet.size());
+  for (TaskParams task : taskSet) {
+    task.duration =
+        std::max(1L, static_cast<long>(std::floor(task.duration * scale)));
+    scaled.push_back(task);
+    horizon = std::min<long long>(
+        std::lcm(horizon, static_cast<long long>(task.period)),
+        std::chrono::milliseconds(maxConfirmHorizon).count());
+    settle = std::max(settle, task.delay + task.jitter);
+  }
+  bool missed = false;
+  Scheduler sched(algo, [&missed](Event e) {
+    missed = missed || e.type == EventType::missed;
+  });
+  sched.useVirtualTime();
+  sched.initTasks(scaled);
+  sched.runFor(std::chrono::milliseconds(2 * horizon + settle));
+  return !missed;
+}
+
+// Most work arriving within any window of the given length once every task
+// has started, over one hyperperiod (capped like the simulation check), or
+// -1 if that means too many arrivals.
+long peakDemand(std::span<const TaskParams> taskSet,
+                std::span<const long> delays, long window) {
+  long long horizon = 1;
+  long start = 0;
+  for (std::size_t i = 0; i < taskSet.size(); i++) {
+    horizon = std::min<long long>(
+        std::lcm(horizon, static_cast<long long>(taskSet[i].period)),
+        std::chrono::milliseconds(maxConfirmHorizon).count());
+    start = std::max(start, delays[i]);
+  }
+  long long end = start + horizon + window;
+  std::vector<std::pair<long long, long>> arrivals;
+  for (std::size_t i = 0; i < taskSet.size(); i++) {
+    for (long long at = delays[i]; at < end; at += taskSet[i].period) {
+      if (arrivals.size() == maxArrivals) {
+        return -1;
+      }
+      arrivals.emplace_back(at, taskSet[i].duration);
+    }
+  }
+  std::ranges::sort(arrivals);
+  long peak = 0;
+  long inWindow = 0;
+  std::size_t first = 0;
+  for (const auto &[at, work] : arrivals) {
+    inWindow += work;
+    while (arrivals[first].first <= at - window) {
+      inWindow -= arrivals[first++].second;
+    }
+    if (at >= start && at < start + horizon) {
+      peak = std::max(peak, inWindow);
+    }
+  }
+  return peak;
+}
+} // namespace
+
+bool feasible(std::span<const AnalysisTask> taskSet, SchedulingAlgo algo) {
+  switch (algo) {
+  case SchedulingAlgo::EDF:
+    return edfFeasible(taskSet);
+  case SchedulingAlgo::RMS:
+    return fixedPriorityFeasible(
+        taskSet, [](const AnalysisTask &t) { return t.period; });
+  case SchedulingAlgo::DM:
+    return fixedPriorityFeasible(taskSet, relative);
+  }
+  return false;
+}
+
+Sensitivity analyze(std::span<const TaskParams> taskSet, SchedulingAlgo algo) {
+  std::vector<AnalysisTask> base;
+  base.reserve(taskSet.size());
+  for (const TaskParams &task : taskSet) {
+    base.push_back({static_cast<double>(task.period),
+                    static_cast<double>(task.duration),
+                    static_cast<double>(task.deadline),
+                    static_cast<double>(task.jitter)});
+  }
+  Sensitivity result;
+  result.taskScale.resize(base.size());
+  result.minPeriod.resize(base.size());
+
+  // Job 0 is the whole set, job 1 + i task i's duration, job 1 + n + i task
+  // i's period; each works on its own copy of the set.
+  std::size_t n = base.size();
+  fanOut(1 + 2 * n, [&](std::size_t job) {
+    std::vector<AnalysisTask> trial = base;
+    if (job == 0) {
+      result.systemScale = searchScale([&](double scale) {
+        for (std::size_t i = 0; i < n; i++) {
+          trial[i].duration = base[i].duration * scale;
+        }
+        return feasible(trial, algo);
+      });
+    } else if (job <= n) {
+      std::size_t i = job - 1;
+      result.taskScale[i] = searchScale([&](double scale) {
+        trial[i].duration = base[i].duration * scale;
+        return feasible(trial, algo);
+      });
+    } else {
+      std::size_t i = job - 1 - n;
+      // The priority order can only change at, or just past, another
+      // task's period or deadline.
+      std::vector<long> starts;
+      for (std::size_t j = 0; j < n; j++) {
+        if (j != i) {
+          for (double at : {base[j].period, relative(base[j])}) {
+            long edge = static_cast<long>(std::ceil(at));
+            starts.push_back(edge);
+            starts.push_back(edge + 1);
+          }
+        }
+      }
+      result.minPeriod[i] = searchPeriod(
+          static_cast<long>(std::ceil(base[i].duration)), std::move(starts),
+          [&](long period) {
+            trial[i].period = period;
+            return feasible(trial, algo);
+          });
+    }
+  });
+  result.confirmed = confirm(taskSet, algo, result.systemScale);
+  return result;
+}
+
+OffsetPlan spreadOffsets(std::span<const TaskParams> taskSet) {
+  OffsetPlan plan;
+  std::size_t n = taskSet.size();
+  plan.delays.resize(n);
+  std::vector<long> given(n);
+  plan.window = std::numeric_limits<long>::max();
+  for (std::size_t i = 0; i < n; i++) {
+    given[i] = taskSet[i].delay;
+    long due = taskSet[i].deadline > 0
+                   ? std::min(taskSet[i].deadline, taskSet[i].period)
+                   : taskSet[i].period;
+    plan.window = std::min(plan.window, due);
+  }
+  if (n == 0) {
+    plan.window = 0;
+    return plan;
+  }
+
+  std::vector<std::size_t> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::ranges::stable_sort(order, {}, [&taskSet](std::size_t i) {
+    return std::pair(taskSet[i].period, -taskSet[i].duration);
+  });
+  std::vector<std::size_t> placed;
+  placed.reserve(n);
+  for (std::size_t i : order) {
+    long period = taskSet[i].period;
+    long step = std::max(1L, period / maxCandidates);
+    long best = 0;
+    std::pair<long, long> bestScore{-1, 0};
+    for (long candidate = 0; candidate < period; candidate += step) {
+      // Closest approach to any placed task's arrivals, then how many
+      // tasks come that close, fewer being better.
+      long closest = std::numeric_limits<long>::max();
+      long atClosest = 0;
+      for (std::size_t j : placed) {
+        long g = std::gcd(period, taskSet[j].period);
+        long r = ((candidate - plan.delays[j]) % g + g) % g;
+        long distance = std::min(r, g - r);
+        if (distance < closest) {
+          closest = distance;
+          atClosest = 0;
+        }
+        atClosest += distance == closest;
+      }
+      std::pair<long, long> score{closest, -atClosest};
+      if (score > bestScore) {
+        bestScore = score;
+        best = candidate;
+      }
+    }
+    plan.delays[i] = best;
+    placed.push_back(i);
+  }
+
+  plan.peakBefore = peakDemand(taskSet, given, plan.window);
+  plan.peakAfter = peakDemand(taskSet, plan.delays, plan.window);
+  if (plan.peakAfter < 0 || plan.peakAfter >= plan.peakBefore) {
+    plan.delays = std::move(given);
+    plan.peakAfter = plan.peakBefore;
+  }
+  return plan;
+}
@@ -0,0 +1,57 @@
+// analysis.hpp - schedulability tests and sensitivity analysis
+#pragma once
+
+#include "process.hpp"
+#include <span>
+#include <vector>
+
+// Tests for synchronous periodic tasks with constrained deadlines:
+// processor demand for EDF, reducing to U <= 1 for implicit deadlines, and
+// response-time analysis for RMS and DM, with ties between equal priorities
+// broken by task order as the scheduler does. Jitter is charged in full, to
+// a task's own response and to the interference it causes, and under EDF
+// shortens its deadline. Exact without jitter; since synchronous arrivals
+// are the worst case, a set that passes also passes with any offsets.
+// Durations and periods are in ms and need not be integral.
+struct AnalysisTask {
+  double period;
+  double duration;
+  // Relative deadline, 0 for the period.
+  double deadline = 0;
+  double jitter = 0;
+};
+bool feasible(std::span<const AnalysisTask> taskSet, SchedulingAlgo algo);
+
+struct Sensitivity {
+  // Largest factor every duration can be multiplied by at once.
+  double systemScale = 0;
+  // Largest factor for each task's duration alone, the others unchanged.
+  std::vector<double> taskScale;
+  // Smallest feasible period of each task in whole ms, -1 if there is none.
+  std::vector<long> minPeriod;
+  // A virtual-time run of the set scaled by systemScale missed no deadline.
+  bool confirmed = false;
+};
+
+// Binary searches over the analytical test, fanned out across all cores,
+// then fast-forwards the scaled set through a deterministic scheduler as a
+// cross-check of the analysis against the simulator itself.
+Sensitivity analyze(std::span<const TaskParams> taskSet, SchedulingAlgo algo);
+
+struct OffsetPlan {
+  // Release delay of each task, in ms.
+  std::vector<long> delays;
+  // Most work arriving within any window as long as the shortest relative
+  // deadline, over a hyperperiod: with the given delays and with the plan's.
+  long peakBefore = 0;
+  long peakAfter = 0;
+  long window = 0;
+};
+
+// Places the tasks one at a time, shortest period first, each at the delay
+// within its period whose arrivals stay furthest from those of the tasks
+// already placed; two tasks' arrivals repeat modulo the gcd of their
+// periods, so the distance is known without unrolling the schedule. The
+// given delays are kept if this does not lower the peak. Cost is quadratic
+// in the number of tasks.
+OffsetPlan spreadOffsets(std::span<const TaskParams> taskSet);
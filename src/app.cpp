@@ -1,9 +1,19 @@
 #include "app.hpp"
+#include "analysis.hpp"
 #include "controls.hpp"
+#include "frameprofiler.hpp"
 #include "process.hpp"
 #include "scheduler.hpp"
+#include "taskset.hpp"
 #include "view.hpp"
+#include "whatif.hpp"
 #include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
 #include <tuple>
 #include <vector>
 
@@ -44,53 +54,375 @@ std::array<Color, 5> procColors = {{{77, 121, 105, 255},
                                     {167, 92, 92, 255},
                                     {176, 119, 84, 255},
                                     {184, 145, 75, 255}}};
+constexpr std::chrono::seconds whatIfHorizon{30};
 }
 
 App::App(float width, float height)
     : execPath(get_executable_path()), view(width, height, execPath),
       controls([this](int id) { this->removeTasks({id}); },
                [this](std::pair<long, long> taskParam) {
-                 this->initTasks({{taskParam.first, taskParam.second, 0}});
+                 TaskParams param{taskParam.first, taskParam.second, 0};
+                 this->initTasks(std::span(&param, 1));
                },
                [this](SchedulingAlgo newAlg) { this->editAlgo(newAlg); },
+               [this](int id, std::pair<long, long> taskParam, EditMode mode) {
+                 this->editTask(id, taskParam.first, taskParam.second, mode);
+               },
+               [this](std::pair<long, long> taskParam) {
+                 this->whatIf(taskParam.first, taskParam.second);
+               },
+               [this](SchedulingAlgo algo) { this->analyze(algo); },
+               [this](long work) { this->submit(work); },
                execPath),
       sched(SchedulingAlgo::EDF,
             [this](Event e) { this->view.eventInterface(e); }),
-      schedT([this]() { this->sched.loop(); }) {}
+      schedT([this]() { this->sched.loop(); }) {
+  sched.subscribe(*parseEventFilter("missed"), 64,
+                  [this](std::span<const Event> batch) {
+                    std::lock_guard lk(missMTX);
+                    for (const Event &e : batch) {
+                      missBuffer[e.id]++;
+                    }
+                  });
+}
 
 App::~App() { sched.stop(); }
 
 void App::draw() {
   view.draw();
   controls.draw();
+  frameProfiler().draw();
 }
 
 void App::advanceView() {
+  frameProfiler().beginFrame();
+  if (IsKeyPressed(KEY_F3)) {
+    frameProfiler().toggle();
+  }
   view.advanceState();
+  std::map<int, long> misses;
+  {
+    std::lock_guard lk(missMTX);
+    std::swap(misses, missBuffer);
+  }
+  controls.countMisses(misses);
   controls.handleInput();
+  if (IsFileDropped()) {
+    FilePathList dropped = LoadDroppedFiles();
+    // Holding shift replaces the current set instead of adding to it.
+    bool replace = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT);
+    for (unsigned int i = 0; i < dropped.count; i++) {
+      loadTasks(dropped.paths[i], replace && i == 0);
+    }
+    UnloadDroppedFiles(dropped);
+  }
+  if (statusJob.valid() && statusJob.wait_for(std::chrono::seconds(0)) ==
+                                  std::future_status::ready) {
+    try {
+      view.showStatus(statusJob.get());
+    } catch (const std::future_error &) {
+      view.showStatus({});
+    }
+  }
+}
+
+// Forks the live schedule with and without the candidate task and compares
+// the next whatIfHorizon of both, off the render and scheduler threads.
+void App::whatIf(long period, long duration) {
+  if (statusJob.valid()) {
+    return;
+  }
+  view.showStatus("What if: running...");
+  statusJob = std::async(
+      std::launch::async,
+      [snap = sched.requestSnapshot(), period, duration]() mutable {
+        std::vector<Transaction> branches(2);
+        branches[1].add({period, duration, 0});
+        auto results = explore(snap.get(), branches, whatIfHorizon);
+        return "What if P " + std::to_string(period) + " D " +
+               std::to_string(duration) + ": missed " +
+               std::to_string(results[0].missed) + " -> " +
+               std::to_string(results[1].missed) + ", preempted " +
+               std::to_string(results[0].preempted) + " -> " +
+               std::to_string(results[1].preempted) + " over " +
+               std::to_string(whatIfHorizon.count()) + "s";
+      });
+}
+
+// Reports how far the current set can be stretched under algo: the common
+// duration scale, the task with the least individual headroom and whether
+// the simulator agrees at the common scale.
+void App::analyze(SchedulingAlgo algo) {
+  if (statusJob.valid() || controls.cards.empty()) {
+    return;
+  }
+  view.showStatus("Analysis: running...");
+  std::vector<TaskParams> taskSet;
+  std::vector<int> ids;
+  taskSet.reserve(controls.cards.size());
+  for (const TaskCard &card : controls.cards) {
+    taskSet.push_back(card.params());
+    ids.push_back(card.id);
+  }
+  statusJob = std::async(
+      std::launch::async,
+      [taskSet = std::move(taskSet), ids = std::move(ids), algo]() {
+        Sensitivity result = ::analyze(taskSet, algo);
+        auto tightest = std::ranges::min_element(result.taskScale);
+        std::size_t i = tightest - result.taskScale.begin();
+        char line[160];
+        std::snprintf(line, sizeof(line),
+                      "%s: durations x%.3f%s, tightest task %d x%.3f "
+                      "(min period %ld)",
+                      algoName(algo), result.systemScale,
+                      result.confirmed ? "" : " (simulation disagrees)",
+                      ids[i], *tightest, result.minPeriod[i]);
+        return std::string(line);
+      });
 }
 
 void App::removeTasks(std::vector<int> tasksId) {
+  hideTasks(tasksId);
+  sched.removeTasks(tasksId);
+  for (Scheduler *peer : peers) {
+    peer->removeTasks(tasksId);
+  }
+}
+
+void App::initTasks(std::span<const TaskParams> paramVector) {
+  showTasks(paramVector);
+  auto at = std::chrono::steady_clock::now();
+  sched.initTasks(paramVector, at);
+  for (Scheduler *peer : peers) {
+    peer->initTasks(paramVector, at);
+  }
+}
+
+void App::editTask(int id, long period, long duration, EditMode mode) {
+  showEdit({id, period, duration, mode});
+  sched.editTask(id, period, duration, mode);
+  for (Scheduler *peer : peers) {
+    peer->editTask(id, period, duration, mode);
+  }
+}
+
+void App::apply(Transaction tx) {
+  hideTasks(tx.removes);
+  showTasks(tx.adds);
+  for (const TaskEdit &edit : tx.edits) {
+    showEdit(edit);
+  }
+  if (tx.algo) {
+    controls.showAlg(*tx.algo);
+    view.showAlgo(*tx.algo);
+  }
+  tx.at = std::chrono::steady_clock::now();
+  sched.commit(tx);
+  // Compared policies are fixed; only the main scheduler switches.
+  tx.algo.reset();
+  for (Scheduler *peer : peers) {
+    peer->commit(tx);
+  }
+}
+
+// Runs the same task set and edit stream under each of algos next to the
+// main scheduler. The peers share one host thread pool; every batch is
+// committed to all of them with the same release origin, so they see
+// identical release patterns. The peers keep slack as their slack policy;
+// with SlackPolicy::none they show the worst-case schedule the main one is
+// measured against. Real workloads, metrics and traces stay with the main
+// scheduler. Call before adding tasks.
+void App::compare(std::vector<SchedulingAlgo> algos, SlackPolicy slack) {
+  if (!peers.empty() || algos.empty()) {
+    return;
+  }
+  view.compare(algos, slack == SlackPolicy::none ? " WCET" : "");
+  peerHost = std::make_unique<SchedulerHost>(algos.size());
+  for (std::size_t i = 0; i < algos.size(); i++) {
+    Scheduler &peer = peerHost->add(
+        algos[i], [this, i](Event e) { this->view.laneInterface(i, e); });
+    peer.setSlackPolicy(slack);
+    peers.push_back(&peer);
+  }
+}
+
+void App::hideTasks(const std::vector<int> &tasksId) {
+  if (tasksId.empty()) {
+    return;
+  }
   view.removeTasks(tasksId);
+  controls.removeCards(tasksId);
+}
 
-  sched.removeTasks(tasksId);
-  std::erase_if(controls.cards, [tasksId](TaskCard t) {
-    return std::find(tasksId.begin(), tasksId.end(), t.id) != tasksId.end();
-  });
-  controls.setInView();
+// The card shows the new values as soon as they are submitted, even if the
+// scheduler only switches at the task's next release.
+void App::showEdit(const TaskEdit &edit) {
+  TaskCard *card = controls.card(edit.id);
+  if (card && edit.period > 0 && edit.duration > 0) {
+    card->period = edit.period;
+    card->duration = edit.duration;
+  }
 }
 
-void App::initTasks(std::vector<std::tuple<long, long, long>> paramVector) {
+void App::showTasks(std::span<const TaskParams> paramVector) {
+  if (paramVector.empty()) {
+    return;
+  }
   view.initTasks(paramVector);
-
-  sched.initTasks(paramVector);
-  for (const auto &[period, duration, _] : paramVector) {
-    controls.cards.emplace_back(nextTaskId, period, duration,
-                                procColors[nextTaskId % 5],
+  controls.cards.reserve(controls.cards.size() + paramVector.size());
+  for (const TaskParams &params : paramVector) {
+    controls.cards.emplace_back(nextTaskId, params, procColors[nextTaskId % 5],
                                 controls.deleteIcon);
     nextTaskId++;
   }
-  controls.setInView();
+  controls.cardsAdded();
+}
+
+bool App::loadTasks(const std::filesystem::path &path, bool replace) {
+  auto taskSet = loadTaskSet(path);
+  if (!taskSet) {
+    return false;
+  }
+  Transaction tx;
+  tx.adds = std::move(*taskSet);
+  if (replace) {
+    tx.removes.reserve(controls.cards.size());
+    for (const TaskCard &card : controls.cards) {
+      tx.removes.push_back(card.id);
+    }
+  }
+  apply(std::move(tx));
+  return true;
+}
+
+// Releases already in flight are not recorded, so every task is saved with
+// a zero delay.
+bool App::saveTasks(const std::filesystem::path &path) {
+  std::vector<TaskParams> taskSet;
+  taskSet.reserve(controls.cards.size());
+  for (const TaskCard &card : controls.cards) {
+    taskSet.push_back(card.params());
+  }
+  return saveTaskSet(path, taskSet);
+}
+
+void App::editAlgo(SchedulingAlgo newAlgo) {
+  view.showAlgo(newAlgo);
+  sched.assignAlgo(newAlgo);
+}
+
+void App::publishMetrics(std::string name) {
+  sched.publishMetrics(std::move(name));
+}
+
+void App::traceTo(const std::filesystem::path &path) { sched.traceTo(path); }
+
+// Writes the matching events to path as text, one per line with the time in
+// ms since the log was opened, from an event bus subscriber thread.
+bool App::logTo(const std::filesystem::path &path, EventFilter filter) {
+  auto out =
+      std::make_shared<std::ofstream>(path, std::ios::out | std::ios::trunc);
+  if (!out->is_open()) {
+    return false;
+  }
+  auto origin = std::chrono::steady_clock::now();
+  sched.subscribe(std::move(filter), 64,
+                  [out, origin](std::span<const Event> batch) {
+                    for (const Event &e : batch) {
+                      *out << std::chrono::duration<double, std::milli>(
+                                  e.time - origin)
+                                  .count()
+                           << ' ' << eventName(e.type) << ' ' << e.id << '\n';
+                    }
+                    out->flush();
+                  });
+  return true;
+}
+
+void App::useDispatchTable(bool enable) {
+  sched.useDispatchTable(enable);
+  for (Scheduler *peer : peers) {
+    peer->useDispatchTable(enable);
+  }
+}
+
+void App::setCoalesceWindow(std::chrono::microseconds window) {
+  sched.setCoalesceWindow(window);
+  for (Scheduler *peer : peers) {
+    peer->setCoalesceWindow(window);
+  }
+}
+
+void App::setPreemptionModel(PreemptionModel model) {
+  sched.setPreemptionModel(model);
+  for (Scheduler *peer : peers) {
+    peer->setPreemptionModel(model);
+  }
+}
+
+// Peers sample the same distribution; as long as releases happen in the
+// same order, their default-seeded generators draw the same times.
+void App::setExecutionTime(int id, ExecutionTime model) {
+  sched.setExecutionTime(id, model);
+  for (Scheduler *peer : peers) {
+    peer->setExecutionTime(id, model);
+  }
+}
+
+void App::setSlackPolicy(SlackPolicy policy) { sched.setSlackPolicy(policy); }
+
+void App::setCriticalSections(int id, std::vector<CriticalSection> sections) {
+  for (Scheduler *peer : peers) {
+    peer->setCriticalSections(id, sections);
+  }
+  sched.setCriticalSections(id, std::move(sections));
+}
+
+void App::setLockProtocol(LockProtocol protocol) {
+  sched.setLockProtocol(protocol);
+  for (Scheduler *peer : peers) {
+    peer->setLockProtocol(protocol);
+  }
+}
+
+bool App::perfReport(std::ostream &out) { return sched.perfReport(out); }
+
+void App::setDvfs(DvfsPolicy policy, PowerModel model) {
+  for (Scheduler *peer : peers) {
+    peer->setDvfs(policy, model);
+  }
+  sched.setDvfs(policy, std::move(model));
+}
+
+// The server gets a card like a task, showing its period and budget, and
+// is removed or edited through it. Aperiodic jobs from the GUI go to the
+// most recently added server.
+void App::addServer(ServerSpec spec) {
+  TaskParams card{spec.period, spec.budget, 0};
+  showTasks(std::span(&card, 1));
+  auto at = std::chrono::steady_clock::now();
+  server = sched.addServer(spec.kind, spec.budget, spec.period, at);
+  for (Scheduler *peer : peers) {
+    peer->addServer(spec.kind, spec.budget, spec.period, at);
+  }
+}
+
+void App::submit(long work) {
+  if (!server || work <= 0) {
+    return;
+  }
+  sched.submit(*server, std::chrono::milliseconds(work));
+  for (Scheduler *peer : peers) {
+    peer->submit(*server, std::chrono::milliseconds(work));
+  }
+}
+
+void App::bindWorkload(int id, Workload body) {
+  sched.bindWorkload(id, std::move(body));
+}
+
+void App::bindCoroutine(int id, CoroutineBody body) {
+  sched.bindCoroutine(id, std::move(body));
 }
 
-void App::editAlgo(SchedulingAlgo newAlgo) { sched.assignAlgo(newAlgo); }
+void App::pinWorkers(int cpu) { sched.pinWorkers(cpu); }
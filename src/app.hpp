@@ -1,9 +1,17 @@
 #pragma once
 
 #include "controls.hpp"
+#include "host.hpp"
 #include "scheduler.hpp"
 #include "view.hpp"
+#include <chrono>
 #include <filesystem>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -12,17 +20,59 @@ struct State;
 class App {
   std::filesystem::path execPath;
   View view;
+  // Deadline misses per task, counted by an event bus subscriber and taken
+  // by the render thread each frame. Declared before sched so they outlive
+  // the subscriber.
+  std::mutex missMTX;
+  std::map<int, long> missBuffer;
   Scheduler sched;
   Controls controls;
   std::jthread schedT;
   int nextTaskId = 0;
+  std::vector<Scheduler *> peers;
+  std::unique_ptr<SchedulerHost> peerHost;
+  // Background job whose result goes to the status line; one at a time.
+  std::future<std::string> statusJob;
+  std::optional<int> server;
+
+  void showTasks(std::span<const TaskParams> paramVector);
+  void hideTasks(const std::vector<int> &tasksId);
+  void showEdit(const TaskEdit &edit);
 
 public:
   App(float width, float height);
   ~App();
   void advanceView();
   void draw();
-  void initTasks(std::vector<std::tuple<long, long, long>> paramVector);
+  void initTasks(std::span<const TaskParams> paramVector);
+  bool loadTasks(const std::filesystem::path &path, bool replace = false);
+  bool saveTasks(const std::filesystem::path &path);
   void removeTasks(std::vector<int> tasksId);
+  void editTask(int id, long period, long duration,
+                EditMode mode = EditMode::nextRelease);
   void editAlgo(SchedulingAlgo newAlgo);
+  void apply(Transaction tx);
+  void compare(std::vector<SchedulingAlgo> algos,
+               SlackPolicy slack = SlackPolicy::reclaim);
+  void whatIf(long period, long duration);
+  void analyze(SchedulingAlgo algo);
+  void publishMetrics(std::string name);
+  void traceTo(const std::filesystem::path &path);
+  bool logTo(const std::filesystem::path &path, EventFilter filter = {});
+  void useDispatchTable(bool enable);
+  void setCoalesceWindow(std::chrono::microseconds window);
+  void setPreemptionModel(PreemptionModel model);
+  void setExecutionTime(int id, ExecutionTime model);
+  void setSlackPolicy(SlackPolicy policy);
+  void setCriticalSections(int id, std::vector<CriticalSection> sections);
+  void setLockProtocol(LockProtocol protocol);
+  void setDvfs(DvfsPolicy policy, PowerModel model);
+  void addServer(ServerSpec spec);
+  void submit(long work);
+  void bindWorkload(int id, Workload body);
+  void bindCoroutine(int id, CoroutineBody body);
+  void pinWorkers(int cpu);
+  // Hardware counters of the main scheduler; false unless built with
+  // EDFSIM_PERF.
+  bool perfReport(std::ostream &out);
 };
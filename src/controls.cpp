@@ -1,6 +1,9 @@
 #include "controls.hpp"
+#include "frameprofiler.hpp"
 #include "process.hpp"
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <filesystem>
 #include <raylib.h>
 #include <string>
@@ -10,14 +13,15 @@ Button::Button(Rectangle area, Color color, Texture icon)
 
 void Button::draw() {
 
-  DrawRectangleRounded(area, 0.15, 0, color);
+  counted(DrawRectangleRounded, area, 0.15, 0, color);
   if (icon) {
     if (flip) {
-      DrawTextureEx(*icon, {area.x + area.width, area.y + area.height}, 180,
-                    area.height / icon->height, WHITE);
+      counted(DrawTextureEx, *icon,
+              {area.x + area.width, area.y + area.height}, 180,
+              area.height / icon->height, WHITE);
     } else {
-      DrawTextureEx(*icon, {area.x, area.y}, 0, area.height / icon->height,
-                    WHITE);
+      counted(DrawTextureEx, *icon, {area.x, area.y}, 0,
+              area.height / icon->height, WHITE);
     }
   }
 }
@@ -27,67 +31,103 @@ InputCard::InputCard(Rectangle area, std::string defaultText, Color color)
 
 void InputCard::draw() {
   if (active) {
-    DrawRectangleRoundedLinesEx(
-        {area.x + area.width * padRatio, area.y + area.height * padRatio,
-         area.width * (1.f - 2 * padRatio), area.height * (1.f - 2 * padRatio)},
-        0.25, 0, 3, RED);
-  }
-  DrawRectangleRounded(
-      {area.x + area.width * padRatio, area.y + area.height * padRatio,
-       area.width * (1.f - 2 * padRatio), area.height * (1.f - 2 * padRatio)},
-      0.25, 0, color);
-  DrawText((input.empty()) ? defaultText.c_str() : input.c_str(),
-           area.x + area.width * 2 * padRatio,
-           area.y + area.height * 0.6 * (1.f - 2 * padRatio),
-           static_cast<int>(area.height * 0.4 * (1.f - 2 * padRatio)), WHITE);
+    counted(DrawRectangleRoundedLinesEx,
+            {area.x + area.width * padRatio, area.y + area.height * padRatio,
+             area.width * (1.f - 2 * padRatio),
+             area.height * (1.f - 2 * padRatio)},
+            0.25, 0, 3, RED);
+  }
+  counted(DrawRectangleRounded,
+          {area.x + area.width * padRatio, area.y + area.height * padRatio,
+           area.width * (1.f - 2 * padRatio),
+           area.height * (1.f - 2 * padRatio)},
+          0.25, 0, color);
+  counted(DrawText, (input.empty()) ? defaultText.c_str() : input.c_str(),
+          area.x + area.width * 2 * padRatio,
+          area.y + area.height * 0.6 * (1.f - 2 * padRatio),
+          static_cast<int>(area.height * 0.4 * (1.f - 2 * padRatio)), WHITE);
 }
 
-TaskCard::TaskCard(int id, long period, long duration, Color color,
+TaskCard::TaskCard(int id, const TaskParams &params, Color color,
                    Texture buttonIcon)
-    : remove({}, BLACK, buttonIcon), id(id), duration(duration), period(period),
-      color(color) {}
+    : color(color), period(params.period), duration(params.duration),
+      deadline(params.deadline), jitter(params.jitter),
+      remove({}, BLACK, buttonIcon), id(id) {}
 
-void TaskCard::draw(int index, Rectangle listRec) {
-  if (index < 0 || index > 4) {
-    return;
-  } else {
-    float cellHeight = listRec.height / 5.f;
-    float offsetY = listRec.y + cellHeight * index;
-    float buttonRatio = 1.f / 3.f;
-    float padRatio = 0.05;
-    int fontSize = 0.3 * (cellHeight * (1 - 2 * padRatio));
-    float fontOffset = 0.4 * (cellHeight * (1 - 2 * padRatio));
-
-    DrawRectangleRounded(
-        {listRec.x + listRec.width * padRatio, offsetY + cellHeight * padRatio,
-         listRec.width * (1 - 2 * padRatio), cellHeight * (1 - 2 * padRatio)},
-        0.15, 0, color);
-
-    DrawText(("ID: " + std::to_string(id)).c_str(),
-             listRec.x + 2 * padRatio * listRec.width, offsetY + fontOffset,
-             fontSize, WHITE);
-
-    DrawText(("P: " + std::to_string(period)).c_str(),
-             listRec.x + (2 * padRatio + 89.f / 480.f) * listRec.width,
-             offsetY + fontOffset, fontSize, WHITE);
-
-    DrawText(("D: " + std::to_string(duration)).c_str(),
-             listRec.x + (2 * padRatio + 209.f / 480.f) * listRec.width,
-             offsetY + fontOffset, fontSize, WHITE);
-
-    remove.area = {
-        listRec.x + (2 * padRatio + 321.f / 480.f) * listRec.width,
-        offsetY + 3 * padRatio * cellHeight,
-        (1 - 6 * padRatio) * cellHeight,
-        (1 - 6 * padRatio) * cellHeight,
-    };
-    remove.draw();
+Rectangle TaskCard::removeArea(float top, Rectangle listRec) const {
+  float cellHeight = listRec.height / rowsInView;
+  float padRatio = 0.05;
+  return {
+      listRec.x + (2 * padRatio + 321.f / 480.f) * listRec.width,
+      top + 3 * padRatio * cellHeight,
+      (1 - 6 * padRatio) * cellHeight,
+      (1 - 6 * padRatio) * cellHeight,
+  };
+}
+
+void TaskCard::draw(float top, Rectangle listRec, bool selected) {
+  float cellHeight = listRec.height / rowsInView;
+  float offsetY = top;
+  float padRatio = 0.05;
+  int fontSize = 0.3 * (cellHeight * (1 - 2 * padRatio));
+  float fontOffset = 0.4 * (cellHeight * (1 - 2 * padRatio));
+
+  counted(DrawRectangleRounded,
+          {listRec.x + listRec.width * padRatio,
+           offsetY + cellHeight * padRatio,
+           listRec.width * (1 - 2 * padRatio), cellHeight * (1 - 2 * padRatio)},
+          0.15, 0, color);
+  if (selected) {
+    counted(DrawRectangleRoundedLinesEx,
+            {listRec.x + listRec.width * padRatio,
+             offsetY + cellHeight * padRatio,
+             listRec.width * (1 - 2 * padRatio),
+             cellHeight * (1 - 2 * padRatio)},
+            0.15, 0, 3, RED);
+  }
+
+  counted(DrawText, ("ID: " + std::to_string(id)).c_str(),
+          listRec.x + 2 * padRatio * listRec.width, offsetY + fontOffset,
+          fontSize, WHITE);
+
+  counted(DrawText, ("P: " + std::to_string(period)).c_str(),
+          listRec.x + (2 * padRatio + 89.f / 480.f) * listRec.width,
+          offsetY + fontOffset, fontSize, WHITE);
+
+  counted(DrawText, ("D: " + std::to_string(duration)).c_str(),
+          listRec.x + (2 * padRatio + 209.f / 480.f) * listRec.width,
+          offsetY + fontOffset, fontSize, WHITE);
+
+  char usage[32];
+  std::snprintf(usage, sizeof(usage), "U: %.3f", utilization());
+  counted(DrawText, usage, listRec.x + 2 * padRatio * listRec.width,
+          offsetY + fontOffset + fontSize + 2, fontSize / 2, WHITE);
+  if (misses) {
+    counted(DrawText, ("missed " + std::to_string(misses)).c_str(),
+            listRec.x + (2 * padRatio + 89.f / 480.f) * listRec.width,
+            offsetY + fontOffset + fontSize + 2, fontSize / 2, RED);
+  }
+
+  if (deadline || jitter) {
+    std::string timing =
+        "Dl: " + std::to_string(deadline) + "  J: " + std::to_string(jitter);
+    counted(DrawText, timing.c_str(),
+            listRec.x + (2 * padRatio + 209.f / 480.f) * listRec.width,
+            offsetY + fontOffset + fontSize + 2, fontSize / 2, WHITE);
   }
+
+  remove.area = removeArea(top, listRec);
+  remove.draw();
 }
 
 Controls::Controls(std::function<void(int)> deleteTask,
                    std::function<void(std::pair<long, long>)> addTask,
                    std::function<void(SchedulingAlgo newAlg)> switchAlg,
+                   std::function<void(int, std::pair<long, long>, EditMode)>
+                       editTask,
+                   std::function<void(std::pair<long, long>)> whatIf,
+                   std::function<void(SchedulingAlgo)> analyze,
+                   std::function<void(long)> submit,
                    std::filesystem::path execPath)
     : listArea({mainRec.x, mainRec.y + mainRec.height * 3.f / 16.f,
                 mainRec.width * 0.9f, mainRec.height * 5.f / 8.f}),
@@ -97,7 +137,9 @@ Controls::Controls(std::function<void(int)> deleteTask,
               mainRec.y + mainRec.height / 40, mainRec.width * 5.f / 16.f,
               mainRec.height * 11.f / 80.f}),
       deleteTaskInterface(deleteTask), addTaskInterface(addTask),
-      assignAlgInterface(switchAlg), execPath(execPath),
+      assignAlgInterface(switchAlg), editTaskInterface(editTask),
+      whatIfInterface(whatIf), analyzeInterface(analyze),
+      submitInterface(submit), execPath(execPath),
       addIcon(LoadTexture((execPath / "assets/add.png").string().c_str())),
       switchIcon(
           LoadTexture((execPath / "assets/switch.png").string().c_str())),
@@ -121,40 +163,6 @@ Controls::Controls(std::function<void(int)> deleteTask,
            mainRec.width * 3 / 4, mainRec.height * 0.09375f},
           {mainRec.x, mainRec.y + mainRec.height * 0.90625f,
            mainRec.width * 3 / 4, mainRec.height * 0.09375f},
-          {
-              listArea.x + (2 * 0.05f + 321.f / 480.f) * listArea.width,
-              listArea.y + 3 * 0.05f * listArea.height / 5.f,
-              (1 - 6 * 0.05f) * listArea.height / 5.f,
-              (1 - 6 * 0.05f) * listArea.height / 5.f,
-          },
-          {
-              listArea.x + (2 * 0.05f + 321.f / 480.f) * listArea.width,
-              listArea.y + 3 * 0.05f * listArea.height / 5.f +
-                  listArea.height / 5.f,
-              (1 - 6 * 0.05f) * listArea.height / 5.f,
-              (1 - 6 * 0.05f) * listArea.height / 5.f,
-          },
-          {
-              listArea.x + (2 * 0.05f + 321.f / 480.f) * listArea.width,
-              listArea.y + 3 * 0.05f * listArea.height / 5.f +
-                  listArea.height * 2 / 5.f,
-              (1 - 6 * 0.05f) * listArea.height / 5.f,
-              (1 - 6 * 0.05f) * listArea.height / 5.f,
-          },
-          {
-              listArea.x + (2 * 0.05f + 321.f / 480.f) * listArea.width,
-              listArea.y + 3 * 0.05f * listArea.height / 5.f +
-                  listArea.height * 3 / 5.f,
-              (1 - 6 * 0.05f) * listArea.height / 5.f,
-              (1 - 6 * 0.05f) * listArea.height / 5.f,
-          },
-          {
-              listArea.x + (2 * 0.05f + 321.f / 480.f) * listArea.width,
-              listArea.y + 3 * 0.05f * listArea.height / 5.f +
-                  listArea.height * 4 / 5.f,
-              (1 - 6 * 0.05f) * listArea.height / 5.f,
-              (1 - 6 * 0.05f) * listArea.height / 5.f,
-          },
       }),
       durationIn(clickables[4], "Task duration", BLACK),
       periodIn(clickables[5], "Task Period", BLACK),
@@ -166,13 +174,15 @@ Controls::Controls(std::function<void(int)> deleteTask,
 }
 
 void Controls::draw() {
-  DrawRectangleRounded(mainRec, 0.1, 0, bgColor);
-  DrawRectangleRounded(edfRec, 0.15, 0, WHITE);
-  DrawText("EDF", edfRec.x + edfRec.width * 0.15,
-           edfRec.y + edfRec.height * 0.25, edfRec.height * 0.5, BLACK);
-  DrawRectangleRounded(rmsRec, 0.15, 0, WHITE);
-  DrawText("RMS", rmsRec.x + rmsRec.width * 0.15,
-           rmsRec.y + rmsRec.height * 0.25, rmsRec.height * 0.5, BLACK);
+  auto scope = frameProfiler().measure(FrameStage::controlsDraw);
+  counted(DrawRectangleRounded, mainRec, 0.1, 0, bgColor);
+  counted(DrawRectangleRounded, edfRec, 0.15, 0, WHITE);
+  counted(DrawText, "EDF", edfRec.x + edfRec.width * 0.15,
+          edfRec.y + edfRec.height * 0.25, edfRec.height * 0.5, BLACK);
+  counted(DrawRectangleRounded, rmsRec, 0.15, 0, WHITE);
+  counted(DrawText, fixedAlg == SchedulingAlgo::DM ? "DM" : "RMS",
+          rmsRec.x + rmsRec.width * 0.15, rmsRec.y + rmsRec.height * 0.25,
+          rmsRec.height * 0.5, BLACK);
   bSwitchAlg.draw();
   bAddTask.draw();
   periodIn.draw();
@@ -180,29 +190,162 @@ void Controls::draw() {
   bScrollUp.draw();
   bScrollDown.draw();
 
-  for (int i = 0; i < cards.size(); i++) {
-    cards[i].draw(i - listInd, listArea);
+  arrange();
+  drawList();
+}
+
+// Only the rows overlapping the list area are drawn, clipped to it.
+void Controls::drawList() {
+  float height = rowHeight();
+  std::size_t first = static_cast<std::size_t>(scrollY / height);
+  std::size_t last = std::min(
+      rows.size(),
+      static_cast<std::size_t>((scrollY + listArea.height) / height) + 1);
+  BeginScissorMode(listArea.x, listArea.y, listArea.width, listArea.height);
+  for (std::size_t i = first; i < last; i++) {
+    TaskCard &card = cards[rows[i]];
+    card.draw(listArea.y + i * height - scrollY, listArea, card.id == selected);
+  }
+  EndScissorMode();
+
+  static constexpr std::array<const char *, 4> sortNames = {
+      "id", "period", "utilization", "misses"};
+  std::string header = "sort: " +
+                       std::string(sortNames[static_cast<int>(sortKey)]) +
+                       (descending ? " (desc)" : "") + "  " +
+                       std::to_string(rows.size()) + "/" +
+                       std::to_string(cards.size()) + " tasks" +
+                       (missedOnly ? ", missed only" : "");
+  counted(DrawText, header.c_str(), listArea.x + listArea.width * 0.05f,
+          listArea.y - 18, 14, BLACK);
+
+  float content = rows.size() * height;
+  if (content > listArea.height) {
+    float thumb =
+        std::max(20.f, listArea.height * listArea.height / content);
+    float at =
+        listArea.y + (listArea.height - thumb) * scrollY / maxScroll();
+    counted(DrawRectangle, listArea.x + listArea.width * 0.96f, at, 4, thumb,
+            WHITE);
+  }
+}
+
+void Controls::cardsAdded() {
+  for (std::size_t i = cardIndex.size(); i < cards.size(); i++) {
+    cardIndex[cards[i].id] = i;
   }
+  rowsStale = true;
 }
 
-void Controls::setInView() {
-  listInd = std::min(listInd, static_cast<int>(cards.size()));
-  int i = listInd;
-  for (; i < cards.size() && i < 5; i++) {
-    cardsInView[i - listInd] = true;
+void Controls::removeCards(const std::vector<int> &ids) {
+  std::vector<bool> removed(cards.size(), false);
+  bool any = false;
+  for (int id : ids) {
+    auto it = cardIndex.find(id);
+    if (it != cardIndex.end()) {
+      removed[it->second] = true;
+      any = true;
+    }
+  }
+  if (!any) {
+    return;
   }
-  for (; i < 5; i++) {
-    cardsInView[i - listInd] = false;
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < cards.size(); i++) {
+    if (removed[i]) {
+      cardIndex.erase(cards[i].id);
+      continue;
+    }
+    if (kept != i) {
+      cards[kept] = std::move(cards[i]);
+      cardIndex[cards[kept].id] = kept;
+    }
+    kept++;
+  }
+  cards.erase(cards.begin() + kept, cards.end());
+  rowsStale = true;
+}
+
+TaskCard *Controls::card(int id) {
+  auto it = cardIndex.find(id);
+  return it == cardIndex.end() ? nullptr : &cards[it->second];
+}
+
+void Controls::countMisses(const std::map<int, long> &misses) {
+  for (const auto &[id, count] : misses) {
+    if (TaskCard *missed = card(id)) {
+      missed->misses += count;
+      rowsStale = rowsStale || missedOnly || sortKey == CardSort::misses;
+    }
   }
 }
 
-void Controls::scroll(bool up) {
-  if (up) {
-    listInd = std::max(0, listInd - 1);
+// Rebuilds the shown rows if stale: filters, then sorts by the key with
+// the id breaking ties, so equal keys keep a stable order.
+void Controls::arrange() {
+  if (!rowsStale) {
+    return;
+  }
+  rowsStale = false;
+  std::vector<std::pair<double, std::size_t>> keyed;
+  keyed.reserve(cards.size());
+  for (std::size_t i = 0; i < cards.size(); i++) {
+    const TaskCard &card = cards[i];
+    if (missedOnly && !card.misses) {
+      continue;
+    }
+    double key = 0;
+    switch (sortKey) {
+    case CardSort::id:
+      key = card.id;
+      break;
+    case CardSort::period:
+      key = card.period;
+      break;
+    case CardSort::utilization:
+      key = card.utilization();
+      break;
+    case CardSort::misses:
+      key = card.misses;
+      break;
+    }
+    keyed.emplace_back(descending ? -key : key, i);
+  }
+  // cards are kept in id order, so the position breaks ties by id.
+  std::ranges::sort(keyed);
+  rows.clear();
+  rows.reserve(keyed.size());
+  for (const auto &[key, i] : keyed) {
+    rows.push_back(i);
+  }
+  scrollTarget = std::min(scrollTarget, maxScroll());
+  scrollY = std::min(scrollY, maxScroll());
+}
+
+float Controls::maxScroll() const {
+  return std::max(0.f, rows.size() * rowHeight() - listArea.height);
+}
+
+void Controls::scroll(float count) {
+  arrange();
+  scrollTarget =
+      std::clamp(scrollTarget + count * rowHeight(), 0.f, maxScroll());
+}
+
+// Clicking the scroll bar track jumps straight to that point of the list.
+void Controls::jumpTo(float y) {
+  arrange();
+  float at = std::clamp((y - listArea.y) / listArea.height, 0.f, 1.f);
+  scrollTarget = scrollY = at * maxScroll();
+}
+
+void Controls::cycleSort(bool reverse) {
+  if (reverse) {
+    descending = !descending;
   } else {
-    listInd =
-        std::min(cards.size() - 1, static_cast<unsigned long>(listInd + 1));
+    sortKey = static_cast<CardSort>((static_cast<int>(sortKey) + 1) % 4);
   }
+  rowsStale = true;
 }
 
 void Controls::handleClick(std::pair<float, float> &&pos) {
@@ -223,10 +366,10 @@ void Controls::handleClick(std::pair<float, float> &&pos) {
     switchAlg();
     break;
   case 1:
-    scroll(true);
+    scroll(-1);
     break;
   case 2:
-    scroll(false);
+    scroll(1);
     break;
   case 3:
     addTask();
@@ -239,20 +382,79 @@ void Controls::handleClick(std::pair<float, float> &&pos) {
     durationIn.active = false;
     periodIn.active = true;
     break;
-  case 6:
-  case 7:
-  case 8:
-  case 9:
-  case 10:
-    if (cardsInView[index - 6]) {
-      deleteTaskInterface(cards[index - 6 + listInd].id);
-    }
-    break;
   default:
+    selectCard(x, y);
     break;
   }
 }
 
+// Rows are hit-tested from the click's offset into the list rather than
+// from fixed rectangles. Clicking a card's remove button deletes it,
+// clicking its body selects it for editing; clicking it again or anywhere
+// else outside the controls clears the selection.
+void Controls::selectCard(float x, float y) {
+  std::optional<int> clicked;
+  if (x >= listArea.x && x <= listArea.x + listArea.width && y >= listArea.y &&
+      y < listArea.y + listArea.height) {
+    if (x >= listArea.x + listArea.width * 0.95f) {
+      jumpTo(y);
+      return;
+    }
+    arrange();
+    std::size_t row = (y - listArea.y + scrollY) / rowHeight();
+    if (row < rows.size()) {
+      const TaskCard &card = cards[rows[row]];
+      float top = listArea.y + row * rowHeight() - scrollY;
+      if (CheckCollisionPointRec({x, y}, card.removeArea(top, listArea))) {
+        deleteTaskInterface(card.id);
+        return;
+      }
+      clicked = card.id;
+    }
+  }
+  selected = clicked == selected ? std::nullopt : clicked;
+}
+
+// Evaluates the task in the inputs without adding it; the inputs are kept.
+void Controls::whatIf() {
+  try {
+    long period = std::stol(periodIn.input);
+    long duration = std::stol(durationIn.input);
+    if (period > 0 && duration > 0) {
+      whatIfInterface({period, duration});
+    }
+  } catch (const std::exception &e) {
+  }
+}
+
+// Sends the duration input as one aperiodic job; the inputs are kept so a
+// burst is a matter of repeated presses.
+void Controls::submitJob() {
+  try {
+    long work = std::stol(durationIn.input);
+    if (work > 0) {
+      submitInterface(work);
+    }
+  } catch (const std::exception &e) {
+  }
+}
+
+// Empty inputs keep the current value. Holding shift applies the edit to the
+// job in progress instead of from the next release on.
+void Controls::editTask(long period, long duration) {
+  TaskCard *card = this->card(*selected);
+  if (!card) {
+    selected.reset();
+    return;
+  }
+  EditMode mode = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT)
+                      ? EditMode::immediate
+                      : EditMode::nextRelease;
+  editTaskInterface(card->id, {period ? period : card->period,
+                               duration ? duration : card->duration},
+                    mode);
+}
+
 void Controls::handleInput() {
   // TODO :: the final function
   if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
@@ -273,6 +475,33 @@ void Controls::handleInput() {
   if (IsKeyPressed(KEY_ENTER)) {
     addTask();
   }
+  if (IsKeyPressed(KEY_W)) {
+    whatIf();
+  }
+  if (IsKeyPressed(KEY_A)) {
+    analyzeInterface(currentAlg);
+  }
+  if (IsKeyPressed(KEY_J)) {
+    submitJob();
+  }
+  if (IsKeyPressed(KEY_S)) {
+    cycleSort(IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT));
+  }
+  if (IsKeyPressed(KEY_M)) {
+    missedOnly = !missedOnly;
+    rowsStale = true;
+  }
+  if (CheckCollisionPointRec(GetMousePosition(), listArea)) {
+    float wheel = GetMouseWheelMove();
+    if (wheel != 0) {
+      scroll(-wheel);
+    }
+  }
+  // Eases toward the target, about 12 times the distance per second.
+  scrollY += (scrollTarget - scrollY) * std::min(1.f, 12.f * GetFrameTime());
+  if (std::abs(scrollTarget - scrollY) < 0.5f) {
+    scrollY = scrollTarget;
+  }
   int key = GetCharPressed();
   while (key) {
     if (key > 0x2F && key < 0x3A) {
@@ -2,13 +2,19 @@
 #include "process.hpp"
 #include <array>
 #include <filesystem>
+#include <cstddef>
 #include <functional>
+#include <map>
 #include <optional>
 #include <raylib.h>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+// What the task list is ordered by.
+enum class CardSort { id = 0, period, utilization, misses };
+
 class Button {
   Rectangle area;
   std::optional<Texture> icon;
@@ -39,24 +45,55 @@ class TaskCard {
   Color color = {44, 48, 59, 255};
   long period;
   long duration;
+  long deadline;
+  long jitter;
+  long misses = 0;
   Button remove;
+  friend class Controls;
+
+  Rectangle removeArea(float top, Rectangle listRec) const;
 
 public:
+  // Rows of the list visible at once; sets the card height.
+  static constexpr int rowsInView = 5;
   int id;
-  TaskCard(int id, long period, long duration, Color color, Texture buttonIcon);
-  void draw(int index, Rectangle listRec);
+  TaskCard(int id, const TaskParams &params, Color color, Texture buttonIcon);
+  // Draws the card as the row starting at top, which may lie partly outside
+  // listRec.
+  void draw(float top, Rectangle listRec, bool selected = false);
+  // The task as shown, without its release delay.
+  TaskParams params() const { return {period, duration, 0, deadline, jitter}; }
+  double utilization() const {
+    return static_cast<double>(duration) / static_cast<double>(period);
+  }
+  friend class App;
 };
 
 class Controls {
-  std::array<bool, 5> cardsInView = {false};
   Color bgColor = {146, 165, 203, 255};
   Rectangle mainRec = {800, 0, 480, 800};
   Rectangle listArea;
   Rectangle edfRec;
   Rectangle rmsRec;
-  int listInd = 0;
-  std::array<Rectangle, 11> clickables;
+  std::array<Rectangle, 6> clickables;
+  // Scroll offset of the list in pixels, and the offset it eases toward;
+  // the wheel and the arrows move the target.
+  float scrollY = 0;
+  float scrollTarget = 0;
+  // Position of each card in cards by id.
+  std::unordered_map<int, std::size_t> cardIndex;
+  // Positions in cards of the rows shown, in display order. Only rebuilt
+  // when the cards, the sort or the filter change, and only the rows in
+  // view are drawn or hit-tested, so the list stays cheap however long it
+  // grows.
+  std::vector<std::size_t> rows;
+  bool rowsStale = true;
+  CardSort sortKey = CardSort::id;
+  bool descending = false;
+  bool missedOnly = false;
   SchedulingAlgo currentAlg = SchedulingAlgo::EDF;
+  // The fixed-priority policy the switch goes to from EDF.
+  SchedulingAlgo fixedAlg = SchedulingAlgo::RMS;
   std::filesystem::path execPath;
 
   std::function<void(int)> deleteTaskInterface;
@@ -65,6 +102,16 @@ class Controls {
 
   std::function<void(std::pair<long, long>)> addTaskInterface;
   std::function<void(SchedulingAlgo newAlg)> assignAlgInterface;
+  std::function<void(int, std::pair<long, long>, EditMode)> editTaskInterface;
+  std::function<void(std::pair<long, long>)> whatIfInterface;
+  std::function<void(SchedulingAlgo)> analyzeInterface;
+  std::function<void(long)> submitInterface;
+  // Card whose task the inputs edit instead of adding a new one.
+  std::optional<int> selected;
+  void selectCard(float x, float y);
+  void editTask(long period, long duration);
+  void whatIf();
+  void submitJob();
   void addTask() {
     long period = 0, duration = 0;
     try {
@@ -77,7 +124,9 @@ class Controls {
           duration = std::stol(this->durationIn.input);
         }
         this->durationIn.input.clear();
-        if (period && duration) {
+        if (selected) {
+          this->editTask(period, duration);
+        } else if (period && duration) {
           this->addTaskInterface({period, duration});
         }
       } catch (const std::exception &e) {
@@ -88,8 +137,8 @@ class Controls {
 
   void switchAlg() {
     if (currentAlg == SchedulingAlgo::EDF) {
-      assignAlgInterface(SchedulingAlgo::RMS);
-      currentAlg = SchedulingAlgo::RMS;
+      assignAlgInterface(fixedAlg);
+      currentAlg = fixedAlg;
       bSwitchAlg.flip = true;
     } else {
       assignAlgInterface(SchedulingAlgo::EDF);
@@ -97,7 +146,14 @@ class Controls {
       bSwitchAlg.flip = false;
     }
   }
-  void scroll(bool up);
+  void arrange();
+  float rowHeight() const { return listArea.height / TaskCard::rowsInView; }
+  float maxScroll() const;
+  // Moves the target by a number of rows, positive toward the end.
+  void scroll(float count);
+  void jumpTo(float y);
+  void cycleSort(bool reverse);
+  void drawList();
   Texture addIcon;
   Texture switchIcon;
   Texture upIcon;
@@ -109,12 +165,30 @@ class Controls {
   void handleClick(std::pair<float, float> &&pos);
 
 public:
-  void setInView();
+  // Indexes the cards appended to cards since the last call.
+  void cardsAdded();
+  // Looks each id up in the index and compacts cards once, keeping their
+  // order; unknown ids are ignored.
+  void removeCards(const std::vector<int> &ids);
+  TaskCard *card(int id);
+  // Adds to the miss count of each task still listed.
+  void countMisses(const std::map<int, long> &misses);
+  void showAlg(SchedulingAlgo alg) {
+    currentAlg = alg;
+    if (alg != SchedulingAlgo::EDF) {
+      fixedAlg = alg;
+    }
+    bSwitchAlg.flip = alg != SchedulingAlgo::EDF;
+  }
   Texture deleteIcon;
   std::vector<TaskCard> cards;
   Controls(std::function<void(int)> deleteTask,
            std::function<void(std::pair<long, long>)> addTask,
            std::function<void(SchedulingAlgo newAlg)> switchAlg,
+           std::function<void(int, std::pair<long, long>, EditMode)> editTask,
+           std::function<void(std::pair<long, long>)> whatIf,
+           std::function<void(SchedulingAlgo)> analyze,
+           std::function<void(long)> submit,
            std::filesystem::path execPath);
 
   void handleInput();
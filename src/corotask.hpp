@@ -0,0 +1,82 @@
+// corotask.hpp - C++20 coroutine task bodies driven by the scheduler thread
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <utility>
+
+// Written by the scheduler before it resumes a job and read by the job's
+// preemption points; both run on the scheduler thread except for signalled,
+// which the interface raises from other threads.
+struct SliceControl {
+  std::chrono::steady_clock::time_point end;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::duration executed{};
+  std::atomic<bool> signalled{false};
+};
+
+// co_await on a preemption point only suspends when the scheduler has work
+// to do: an interrupt is due or the interface changed. Otherwise the job
+// keeps running without leaving its frame.
+class PreemptionPoint {
+  const SliceControl *slice;
+
+public:
+  explicit PreemptionPoint(const SliceControl *slice) : slice(slice) {}
+  bool await_ready() const noexcept {
+    return !slice->signalled.load(std::memory_order_relaxed) &&
+           std::chrono::steady_clock::now() < slice->end;
+  }
+  void await_suspend(std::coroutine_handle<>) const noexcept {}
+  void await_resume() const noexcept {}
+  std::chrono::steady_clock::duration elapsed() const {
+    return slice->executed + (std::chrono::steady_clock::now() - slice->start);
+  }
+};
+
+class CoroJob {
+public:
+  struct promise_type {
+    CoroJob get_return_object() {
+      return CoroJob(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  CoroJob() = default;
+  explicit CoroJob(std::coroutine_handle<promise_type> handle)
+      : handle(handle) {}
+  CoroJob(CoroJob &&other) noexcept
+      : handle(std::exchange(other.handle, nullptr)) {}
+  CoroJob &operator=(CoroJob &&other) noexcept {
+    if (this != &other) {
+      if (handle) {
+        handle.destroy();
+      }
+      handle = std::exchange(other.handle, nullptr);
+    }
+    return *this;
+  }
+  CoroJob(const CoroJob &) = delete;
+  CoroJob &operator=(const CoroJob &) = delete;
+  ~CoroJob() {
+    if (handle) {
+      handle.destroy();
+    }
+  }
+
+  bool valid() const { return static_cast<bool>(handle); }
+  bool done() const { return !handle || handle.done(); }
+  void resume() { handle.resume(); }
+
+private:
+  std::coroutine_handle<promise_type> handle;
+};
+
+using CoroutineBody = std::function<CoroJob(PreemptionPoint)>;
@@ -0,0 +1,78 @@
+#include "dvfs.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <system_error>
+
+namespace {
+bool parseDouble(std::string_view text, double &value) {
+  auto [end, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  return ec == std::errc{} && end == text.data() + text.size();
+}
+} // namespace
+
+double PowerModel::power(double speed) const {
+  return staticPower + (1 - staticPower) * std::pow(speed, exponent);
+}
+
+double PowerModel::levelFor(double speed) const {
+  auto it = std::ranges::lower_bound(levels, speed - 1e-9);
+  return it == levels.end() ? 1.0 : *it;
+}
+
+std::optional<DvfsPolicy> parseDvfsPolicy(std::string_view name) {
+  if (name == "off") {
+    return DvfsPolicy::off;
+  }
+  if (name == "static") {
+    return DvfsPolicy::staticSlowdown;
+  }
+  if (name == "cc") {
+    return DvfsPolicy::cycleConserving;
+  }
+  if (name == "la") {
+    return DvfsPolicy::lookAhead;
+  }
+  return std::nullopt;
+}
+
+std::optional<PowerModel> parsePowerModel(std::string_view spec) {
+  PowerModel model;
+  model.levels.clear();
+  std::string_view list = spec.substr(0, spec.find(':'));
+  while (!list.empty()) {
+    auto comma = list.find(',');
+    double level;
+    if (!parseDouble(list.substr(0, comma), level) || level <= 0 ||
+        level > 1) {
+      return std::nullopt;
+    }
+    model.levels.push_back(level);
+    list = comma == std::string_view::npos ? std::string_view{}
+                                           : list.substr(comma + 1);
+  }
+  model.levels.push_back(1.0);
+  std::ranges::sort(model.levels);
+  auto [first, last] = std::ranges::unique(model.levels);
+  model.levels.erase(first, last);
+
+  double *constants[] = {&model.staticPower, &model.exponent,
+                         &model.idlePower};
+  auto colon = spec.find(':');
+  for (double *constant : constants) {
+    if (colon == std::string_view::npos) {
+      break;
+    }
+    auto next = spec.find(':', colon + 1);
+    if (!parseDouble(spec.substr(colon + 1, next - colon - 1), *constant) ||
+        *constant < 0) {
+      return std::nullopt;
+    }
+    colon = next;
+  }
+  if (colon != std::string_view::npos || model.staticPower > 1) {
+    return std::nullopt;
+  }
+  return model;
+}
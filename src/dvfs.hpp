@@ -0,0 +1,40 @@
+// dvfs.hpp - simulated processor speed levels and power draw
+#pragma once
+
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// How the scheduler picks the processor speed, re-evaluated at every
+// scheduling decision. staticSlowdown runs at the lowest level at which the
+// worst-case task set passes the schedulability test of the policy.
+// cycleConserving (Pillai and Shin) lowers the speed as jobs finish early:
+// under EDF a finished job counts with its actual work instead of its
+// duration until its next release; under RMS the processor keeps pace with
+// the static slowdown schedule until the next deadline, finished jobs
+// claiming no cycles. lookAhead (EDF) defers as much work as it can past
+// the earliest deadline and runs just fast enough for the rest; under RMS
+// it behaves as cycleConserving.
+enum class DvfsPolicy { off = 0, staticSlowdown, cycleConserving, lookAhead };
+
+// Speeds are fractions of the full clock; durations are the work at full
+// speed and take duration / speed to run. Power is relative to running at
+// full speed: staticPower plus a dynamic part growing with speed^exponent,
+// or idlePower when nothing runs.
+struct PowerModel {
+  std::vector<double> levels{0.25, 0.5, 0.75, 1.0};
+  double staticPower = 0.1;
+  double exponent = 3;
+  double idlePower = 0.05;
+
+  double power(double speed) const;
+  // Lowest level at or above speed, or full speed if there is none.
+  double levelFor(double speed) const;
+};
+
+// Parses off, static, cc or la.
+std::optional<DvfsPolicy> parseDvfsPolicy(std::string_view name);
+
+// Parses <level>,<level>,...[:<static>:<exponent>:<idle>], levels in
+// (0, 1]. Full speed is always available.
+std::optional<PowerModel> parsePowerModel(std::string_view spec);
@@ -0,0 +1,405 @@
+// edfsim_replay.cpp - deterministic headless run of a task set, printing a
+// hash of the resulting event trace
+#include "analysis.hpp"
+#include "eventbus.hpp"
+#include "exectime.hpp"
+#include "scheduler.hpp"
+#include "taskset.hpp"
+#include "trace.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+// Response times and throughput of one run, from its event stream.
+struct RunStats {
+  std::uint64_t released = 0;
+  std::uint64_t completed = 0;
+  std::uint64_t missed = 0;
+  double responseMs = 0;
+  std::map<int, std::chrono::steady_clock::time_point> releasedAt;
+  std::optional<ResponseHistogram> aperiodic;
+  std::vector<std::pair<int, BlockingStats>> blocking;
+  double energy = 0;
+
+  void push(const Event &e) {
+    switch (e.type) {
+    case EventType::missed:
+      missed++;
+      break;
+    case EventType::initialize:
+    case EventType::restart:
+      released++;
+      releasedAt[e.id] = e.time;
+      break;
+    case EventType::complete:
+      completed++;
+      responseMs += std::chrono::duration<double, std::milli>(
+                        e.time - releasedAt[e.id])
+                        .count();
+      break;
+    default:
+      break;
+    }
+  }
+  double meanResponse() const {
+    return completed ? responseMs / completed : 0;
+  }
+};
+
+const char *policyName(SlackPolicy policy) {
+  switch (policy) {
+  case SlackPolicy::none:
+    return "wcet";
+  case SlackPolicy::reclaim:
+    return "reclaim";
+  case SlackPolicy::donate:
+    return "donate";
+  }
+  return "?";
+}
+
+void printStats(const char *name, const RunStats &stats, double seconds,
+                const RunStats *baseline) {
+  std::printf("%-8s %16.3f %14.3f %8llu", name, stats.meanResponse(),
+              stats.completed / seconds,
+              static_cast<unsigned long long>(stats.missed));
+  if (baseline && baseline->completed && stats.completed) {
+    std::printf("   response %+.1f%% throughput %+.1f%%",
+                100 * (stats.meanResponse() / baseline->meanResponse() - 1),
+                100 * (static_cast<double>(stats.completed) /
+                           baseline->completed -
+                       1));
+  }
+  std::printf("\n");
+}
+
+const char *dvfsName(DvfsPolicy policy) {
+  switch (policy) {
+  case DvfsPolicy::off:
+    return "off";
+  case DvfsPolicy::staticSlowdown:
+    return "static";
+  case DvfsPolicy::cycleConserving:
+    return "cc";
+  case DvfsPolicy::lookAhead:
+    return "la";
+  }
+  return "?";
+}
+
+void printPercentiles(const ResponseHistogram &responses) {
+  std::printf("aperiodic %llu p50 %.3fms p95 %.3fms p99 %.3fms max %.3fms\n",
+              static_cast<unsigned long long>(responses.count()),
+              responses.percentile(0.5).count() / 1e3,
+              responses.percentile(0.95).count() / 1e3,
+              responses.percentile(0.99).count() / 1e3,
+              responses.percentile(1).count() / 1e3);
+}
+
+void printBlocking(const RunStats &stats) {
+  std::printf("%6s %12s %10s\n", "task", "blocked ms", "inversions");
+  for (const auto &[id, b] : stats.blocking) {
+    std::printf("%6d %12.3f %10llu\n", id,
+                std::chrono::duration<double, std::milli>(b.blocked).count(),
+                static_cast<unsigned long long>(b.inversions));
+  }
+}
+
+int printAnalysis(std::span<const TaskParams> taskSet, SchedulingAlgo algo) {
+  Sensitivity result = analyze(taskSet, algo);
+  std::printf("system scale %.4f%s\n", result.systemScale,
+              result.confirmed ? "" : " (not confirmed by simulation)");
+  std::printf("%6s %10s %10s %10s %12s\n", "task", "period", "duration",
+              "scale", "min period");
+  for (std::size_t i = 0; i < taskSet.size(); i++) {
+    std::printf("%6zu %10ld %10ld %10.4f %12ld\n", i, taskSet[i].period,
+                taskSet[i].duration, result.taskScale[i],
+                result.minPeriod[i]);
+  }
+  return result.confirmed ? 0 : 2;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string path;
+  SchedulingAlgo algo = SchedulingAlgo::EDF;
+  long horizonMs = 10000;
+  std::uint64_t seed = 0;
+  long coalesceUs = -1;
+  bool dump = false;
+  bool analysis = false;
+  bool perf = false;
+  bool spread = false;
+  std::optional<ExecutionTime> execTime;
+  std::optional<SlackPolicy> slackPolicy;
+  std::optional<ServerSpec> server;
+  double meanGapMs = 0;
+  long jobWorkMs = 0;
+  std::optional<LockProtocol> protocol;
+  std::optional<DvfsPolicy> dvfs;
+  PowerModel power;
+  std::map<int, std::vector<CriticalSection>> sections;
+  std::optional<std::uint64_t> expect;
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    if (arg == "--rms") {
+      algo = SchedulingAlgo::RMS;
+    } else if (arg == "--dm") {
+      algo = SchedulingAlgo::DM;
+    } else if (arg == "--spread-offsets") {
+      spread = true;
+    } else if (arg == "--horizon" && i + 1 < argc) {
+      horizonMs = std::stol(argv[++i]);
+    } else if (arg == "--seed" && i + 1 < argc) {
+      seed = std::stoull(argv[++i]);
+    } else if (arg == "--coalesce" && i + 1 < argc) {
+      coalesceUs = std::stol(argv[++i]);
+    } else if (arg == "--exec" && i + 1 < argc) {
+      execTime = parseExecutionTime(argv[++i]);
+      if (!execTime) {
+        std::cerr << "edfsim-replay: bad execution time " << argv[i]
+                  << std::endl;
+        return 1;
+      }
+    } else if (arg == "--slack" && i + 1 < argc) {
+      std::string_view name = argv[++i];
+      slackPolicy = name == "none"     ? SlackPolicy::none
+                    : name == "donate" ? SlackPolicy::donate
+                                       : SlackPolicy::reclaim;
+    } else if (arg == "--server" && i + 1 < argc) {
+      server = parseServer(argv[++i]);
+      if (!server) {
+        std::cerr << "edfsim-replay: bad server " << argv[i] << std::endl;
+        return 1;
+      }
+    } else if (arg == "--aperiodic" && i + 1 < argc) {
+      std::string_view spec = argv[++i];
+      auto colon = spec.find(':');
+      meanGapMs = std::stod(std::string(spec.substr(0, colon)));
+      jobWorkMs = colon == std::string_view::npos
+                      ? 1
+                      : std::stol(std::string(spec.substr(colon + 1)));
+    } else if (arg == "--protocol" && i + 1 < argc) {
+      protocol = parseLockProtocol(argv[++i]);
+      if (!protocol) {
+        std::cerr << "edfsim-replay: bad protocol " << argv[i] << std::endl;
+        return 1;
+      }
+    } else if (arg == "--section" && i + 1 < argc) {
+      auto section = parseCriticalSection(argv[++i]);
+      if (!section) {
+        std::cerr << "edfsim-replay: bad section " << argv[i] << std::endl;
+        return 1;
+      }
+      sections[section->first].push_back(std::move(section->second));
+    } else if (arg == "--dvfs" && i + 1 < argc) {
+      dvfs = parseDvfsPolicy(argv[++i]);
+      if (!dvfs) {
+        std::cerr << "edfsim-replay: bad dvfs policy " << argv[i] << std::endl;
+        return 1;
+      }
+    } else if (arg == "--power" && i + 1 < argc) {
+      auto model = parsePowerModel(argv[++i]);
+      if (!model) {
+        std::cerr << "edfsim-replay: bad power model " << argv[i] << std::endl;
+        return 1;
+      }
+      power = *model;
+    } else if (arg == "--analyze") {
+      analysis = true;
+    } else if (arg == "--perf") {
+      perf = true;
+    } else if (arg == "--dump") {
+      dump = true;
+    } else if (arg == "--expect" && i + 1 < argc) {
+      expect = std::stoull(argv[++i], nullptr, 16);
+    } else if (arg == "--help") {
+      std::cout << "usage: edfsim-replay [--rms|--dm] [--horizon ms] "
+                   "[--seed n] [--coalesce us] [--dump] [--expect hash]\n"
+                   "                     [--analyze] [--spread-offsets] "
+                   "[--perf] [--exec fixed|uniform:lo:hi|hist:file]\n"
+                   "                     "
+                   "[--slack none|reclaim|donate]\n"
+                   "                     [--server cbs|polling|deferrable:"
+                   "budget:period] [--aperiodic mean-gap:work]\n"
+                   "                     [--protocol none|pip|pcp|srp] "
+                   "[--section task:resource:start:length]\n"
+                   "                     [--dvfs off|static|cc|la] "
+                   "[--power levels[:static:exponent:idle]] tasks.csv\n";
+      return 0;
+    } else {
+      path = arg;
+    }
+  }
+
+  auto taskSet = loadTaskSet(path);
+  if (!taskSet) {
+    std::cerr << "edfsim-replay: cannot read task set " << path << std::endl;
+    return 1;
+  }
+  if (spread) {
+    OffsetPlan plan = spreadOffsets(*taskSet);
+    for (std::size_t i = 0; i < taskSet->size(); i++) {
+      (*taskSet)[i].delay = plan.delays[i];
+    }
+    std::printf("offsets: work released in the busiest %ldms window %ldms -> "
+                "%ldms\n",
+                plan.window, plan.peakBefore, plan.peakAfter);
+  }
+  if (analysis) {
+    return printAnalysis(*taskSet, algo);
+  }
+
+  // One run of the set under policy; the hashed, dumped and profiled run
+  // is the one asked for, the others only feed the comparison.
+  std::ostringstream perfText;
+  bool perfBuilt = false;
+  auto simulate = [&](SlackPolicy policy, DvfsPolicy speeds, bool primary,
+                      TraceHash &hash) {
+    RunStats stats;
+    Scheduler sched(algo, [&](Event e) {
+      stats.push(e);
+      if (!primary) {
+        return;
+      }
+      hash.push(e);
+      if (dump) {
+        std::printf("%12.3f %-10s %d\n",
+                    std::chrono::duration<double, std::milli>(
+                        e.time.time_since_epoch())
+                        .count(),
+                    eventName(e.type), e.id);
+      }
+    });
+    sched.useVirtualTime(seed);
+    if (coalesceUs >= 0) {
+      sched.setCoalesceWindow(std::chrono::microseconds(coalesceUs));
+    }
+    sched.setSlackPolicy(policy);
+    sched.setDvfs(speeds, power);
+    if (protocol) {
+      sched.setLockProtocol(*protocol);
+    }
+    sched.initTasks(*taskSet);
+    if (execTime) {
+      for (int id = 0; id < static_cast<int>(taskSet->size()); id++) {
+        sched.setExecutionTime(id, *execTime);
+      }
+    }
+    for (const auto &[id, list] : sections) {
+      sched.setCriticalSections(id, list);
+    }
+    auto collect = [&]() {
+      stats.energy = sched.energy();
+      if (primary && perf) {
+        perfBuilt = sched.perfReport(perfText);
+      }
+      if (!protocol && sections.empty()) {
+        return;
+      }
+      for (int id = 0; id < static_cast<int>(taskSet->size()); id++) {
+        if (auto b = sched.blocking(id)) {
+          stats.blocking.emplace_back(id, *b);
+        }
+      }
+    };
+    if (!server) {
+      sched.runFor(std::chrono::milliseconds(horizonMs));
+      collect();
+      return stats;
+    }
+    int id = sched.addServer(server->kind, server->budget, server->period);
+    // Poisson arrivals of fixed-size jobs, drawn from their own generator
+    // so that every policy sees the same ones.
+    std::mt19937_64 arrivals(seed);
+    double elapsed = 0;
+    while (meanGapMs > 0) {
+      double u = static_cast<double>(arrivals() >> 11) * 0x1.0p-53;
+      double gap = -std::log1p(-u) * meanGapMs;
+      if (elapsed + gap >= horizonMs) {
+        break;
+      }
+      auto step = std::chrono::round<std::chrono::microseconds>(
+          std::chrono::duration<double, std::milli>(gap));
+      sched.runFor(step);
+      elapsed += gap;
+      sched.submit(id, std::chrono::milliseconds(jobWorkMs));
+    }
+    sched.runFor(std::chrono::milliseconds(horizonMs) -
+                 std::chrono::round<std::chrono::microseconds>(
+                     std::chrono::duration<double, std::milli>(elapsed)));
+    stats.aperiodic = sched.serverResponses(id);
+    collect();
+    return stats;
+  };
+
+  TraceHash hash;
+  SlackPolicy policy = slackPolicy.value_or(SlackPolicy::reclaim);
+  DvfsPolicy speeds = dvfs.value_or(DvfsPolicy::off);
+  RunStats stats = simulate(policy, speeds, true, hash);
+  std::printf("events %llu hash %016llx\n",
+              static_cast<unsigned long long>(hash.events()),
+              static_cast<unsigned long long>(hash.value()));
+  if (stats.aperiodic) {
+    printPercentiles(*stats.aperiodic);
+  }
+  if (!stats.blocking.empty()) {
+    printBlocking(stats);
+  }
+  // With variable execution times, compare against every job taking its
+  // full duration, with the same seed.
+  if (execTime || slackPolicy) {
+    TraceHash unused;
+    RunStats baseline = simulate(SlackPolicy::none, speeds, false, unused);
+    double seconds = horizonMs / 1000.0;
+    std::printf("%-8s %16s %14s %8s\n", "policy", "mean response ms",
+                "throughput/s", "missed");
+    printStats(policyName(SlackPolicy::none), baseline, seconds, nullptr);
+    if (policy != SlackPolicy::none) {
+      printStats(policyName(policy), stats, seconds, &baseline);
+    }
+  }
+  // Energy of every speed policy on the same releases and execution times,
+  // scaled to one hyperperiod of the task set.
+  if (dvfs) {
+    long long hyperperiod = 1;
+    for (const TaskParams &task : *taskSet) {
+      hyperperiod = std::lcm(hyperperiod, static_cast<long long>(task.period));
+    }
+    std::printf("hyperperiod %lldms\n%-8s %18s %8s %16s\n", hyperperiod,
+                "dvfs", "energy/hyperperiod", "missed", "mean response ms");
+    for (DvfsPolicy each :
+         {DvfsPolicy::off, DvfsPolicy::staticSlowdown,
+          DvfsPolicy::cycleConserving, DvfsPolicy::lookAhead}) {
+      TraceHash unused;
+      RunStats run =
+          each == speeds ? stats : simulate(policy, each, false, unused);
+      std::printf("%-8s %18.4f %8llu %16.3f\n", dvfsName(each),
+                  run.energy * hyperperiod / horizonMs,
+                  static_cast<unsigned long long>(run.missed),
+                  run.meanResponse());
+    }
+  }
+  if (perf && !perfBuilt) {
+    std::cerr << "edfsim-replay: --perf needs a build with EDFSIM_PERF=ON"
+              << std::endl;
+  } else if (perf) {
+    std::cout << perfText.str();
+  }
+  if (expect && *expect != hash.value()) {
+    std::cerr << "edfsim-replay: trace hash differs from expected"
+              << std::endl;
+    return 2;
+  }
+  return 0;
+}
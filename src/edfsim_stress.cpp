@@ -0,0 +1,380 @@
+// edfsim_stress.cpp - control-plane churn against a live scheduler thread
+#include "scheduler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+enum class Op { add = 0, remove, algo };
+constexpr int opKinds = 3;
+const char *opNames[opKinds] = {"add", "remove", "algo"};
+
+// One command of a churn script, due at offset from the start.
+struct ScriptLine {
+  std::chrono::microseconds at{};
+  Op op = Op::add;
+  std::vector<TaskParams> adds;
+  int count = 1;
+  SchedulingAlgo algo = SchedulingAlgo::EDF;
+};
+
+// Lines are "<ms> add <period> <duration> [delay]", "<ms> remove [count]"
+// (the oldest live tasks) or "<ms> algo edf|rms|dm"; # starts a comment.
+std::optional<std::vector<ScriptLine>>
+loadScript(const std::string &path) {
+  std::ifstream in(path);
+  if (!in) {
+    return std::nullopt;
+  }
+  std::vector<ScriptLine> script;
+  std::string text;
+  while (std::getline(in, text)) {
+    text = text.substr(0, text.find('#'));
+    std::istringstream line(text);
+    double ms;
+    std::string op;
+    if (!(line >> ms >> op)) {
+      continue;
+    }
+    ScriptLine s;
+    s.at = std::chrono::microseconds(static_cast<long long>(ms * 1000));
+    if (op == "add") {
+      long period, duration, delay = 0;
+      if (!(line >> period >> duration) || period <= 0 || duration <= 0) {
+        return std::nullopt;
+      }
+      line >> delay;
+      s.adds.push_back({period, duration, delay});
+    } else if (op == "remove") {
+      s.op = Op::remove;
+      line >> s.count;
+    } else if (op == "algo") {
+      std::string name;
+      line >> name;
+      if (name != "edf" && name != "rms" && name != "dm") {
+        return std::nullopt;
+      }
+      s.op = Op::algo;
+      s.algo = name == "rms"  ? SchedulingAlgo::RMS
+               : name == "dm" ? SchedulingAlgo::DM
+                              : SchedulingAlgo::EDF;
+    } else {
+      return std::nullopt;
+    }
+    script.push_back(std::move(s));
+  }
+  std::ranges::stable_sort(script, {}, &ScriptLine::at);
+  return script;
+}
+
+// Ids of the tasks the harness has added and not removed yet, oldest first.
+class LiveTasks {
+  std::mutex liveMTX;
+  std::deque<int> ids;
+
+public:
+  void add(int first, int count) {
+    std::lock_guard lk(liveMTX);
+    for (int i = 0; i < count; i++) {
+      ids.push_back(first + i);
+    }
+  }
+  std::size_t size() {
+    std::lock_guard lk(liveMTX);
+    return ids.size();
+  }
+  // count random tasks, or the oldest ones if rng is null
+  std::vector<int> take(std::size_t count, std::mt19937_64 *rng) {
+    std::lock_guard lk(liveMTX);
+    std::vector<int> taken;
+    while (taken.size() < count && !ids.empty()) {
+      if (!rng) {
+        taken.push_back(ids.front());
+        ids.pop_front();
+        continue;
+      }
+      std::size_t i = (*rng)() % ids.size();
+      taken.push_back(ids[i]);
+      ids[i] = ids.back();
+      ids.pop_back();
+    }
+    return taken;
+  }
+};
+
+// Command-to-effect latencies in microseconds, per operation.
+struct Latencies {
+  std::vector<double> of[opKinds];
+  std::uint64_t late = 0;
+
+  void merge(Latencies &other) {
+    for (int i = 0; i < opKinds; i++) {
+      of[i].insert(of[i].end(), other.of[i].begin(), other.of[i].end());
+    }
+    late += other.late;
+  }
+};
+
+struct Pending {
+  Op op;
+  Clock::time_point issued;
+  std::future<Clock::time_point> applied;
+};
+
+// Records the fences that have resolved; all of them if wait.
+void harvest(std::deque<Pending> &pending, Latencies &lat, bool wait) {
+  while (!pending.empty()) {
+    Pending &p = pending.front();
+    if (!wait && p.applied.wait_for(std::chrono::seconds(0)) !=
+                     std::future_status::ready) {
+      return;
+    }
+    try {
+      lat.of[static_cast<int>(p.op)].push_back(
+          std::chrono::duration<double, std::micro>(p.applied.get() -
+                                                    p.issued)
+              .count());
+    } catch (const std::future_error &) {
+      // The scheduler stopped before applying it.
+    }
+    pending.pop_front();
+  }
+}
+
+void printRow(const char *label, std::vector<double> &values) {
+  if (values.empty()) {
+    std::printf("%-8s %8s\n", label, "-");
+    return;
+  }
+  std::ranges::sort(values);
+  auto at = [&](double q) {
+    return values[std::min(values.size() - 1,
+                           static_cast<std::size_t>(q * values.size()))];
+  };
+  std::printf("%-8s %8zu %10.1f %10.1f %10.1f %10.1f\n", label, values.size(),
+              at(0.5), at(0.99), at(0.999), values.back());
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  int threads = 4;
+  double rate = 200;
+  double seconds = 5;
+  int weights[opKinds] = {5, 4, 1};
+  int maxBatch = 4;
+  std::size_t maxTasks = 200;
+  std::uint64_t seed = 0;
+  double stallMs = 10;
+  double probeMs = 5;
+  std::optional<std::string> scriptPath;
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    if (arg == "--threads" && i + 1 < argc) {
+      threads = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--rate" && i + 1 < argc) {
+      rate = std::stod(argv[++i]);
+    } else if (arg == "--seconds" && i + 1 < argc) {
+      seconds = std::stod(argv[++i]);
+    } else if (arg == "--mix" && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%d:%d:%d", &weights[0], &weights[1],
+                      &weights[2]) != 3 ||
+          std::ranges::any_of(weights, [](int w) { return w < 0; }) ||
+          weights[0] + weights[1] + weights[2] == 0) {
+        std::cerr << "edfsim-stress: bad mix " << argv[i] << std::endl;
+        return 1;
+      }
+    } else if (arg == "--batch" && i + 1 < argc) {
+      maxBatch = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--max-tasks" && i + 1 < argc) {
+      maxTasks = std::stoul(argv[++i]);
+    } else if (arg == "--seed" && i + 1 < argc) {
+      seed = std::stoull(argv[++i]);
+    } else if (arg == "--stall" && i + 1 < argc) {
+      stallMs = std::stod(argv[++i]);
+    } else if (arg == "--probe" && i + 1 < argc) {
+      probeMs = std::stod(argv[++i]);
+    } else if (arg == "--script" && i + 1 < argc) {
+      scriptPath = argv[++i];
+    } else if (arg == "--help") {
+      std::cout << "usage: edfsim-stress [--threads n] [--rate ops/s/thread] "
+                   "[--seconds s] [--mix add:remove:algo]\n"
+                   "                     [--batch max-adds] [--max-tasks n] "
+                   "[--seed n] [--stall ms] [--probe ms]\n"
+                   "                     [--script churn.txt]\n";
+      return 0;
+    } else {
+      std::cerr << "edfsim-stress: unknown option " << arg << std::endl;
+      return 1;
+    }
+  }
+  std::optional<std::vector<ScriptLine>> script;
+  if (scriptPath) {
+    script = loadScript(*scriptPath);
+    if (!script) {
+      std::cerr << "edfsim-stress: cannot read script " << *scriptPath
+                << std::endl;
+      return 1;
+    }
+  }
+
+  std::atomic<std::uint64_t> events = 0;
+  Scheduler sched(SchedulingAlgo::EDF, [&](Event) {
+    events.fetch_add(1, std::memory_order_relaxed);
+  });
+  std::jthread schedT([&]() { sched.loop(); });
+  LiveTasks live;
+  std::mutex mergeMTX;
+  Latencies total;
+  std::atomic<bool> done = false;
+  auto start = Clock::now();
+  auto end = start + std::chrono::duration_cast<Clock::duration>(
+                         std::chrono::duration<double>(seconds));
+
+  // Each worker issues commands on a fixed schedule and fences each one;
+  // a command issued after its slot counts as late, a sign that the
+  // interface lock held the worker back.
+  auto worker = [&](int index) {
+    std::mt19937_64 rng(seed * 1000003 + index);
+    std::discrete_distribution<int> pick(std::begin(weights),
+                                         std::end(weights));
+    std::uniform_int_distribution<long> period(20, 2000);
+    Latencies lat;
+    std::deque<Pending> pending;
+    auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1 / std::max(rate, 1e-3)));
+    auto slot = start;
+    while (slot < end) {
+      std::this_thread::sleep_until(slot);
+      auto issued = Clock::now();
+      if (issued - slot > interval) {
+        lat.late++;
+      }
+      auto op = static_cast<Op>(pick(rng));
+      if (op == Op::add && live.size() >= maxTasks) {
+        op = Op::remove;
+      }
+      if (op == Op::add) {
+        Transaction tx;
+        int count = 1 + static_cast<int>(rng() % maxBatch);
+        for (int i = 0; i < count; i++) {
+          long p = period(rng);
+          tx.add({p, std::max(1L, static_cast<long>(p * 0.02)), 0});
+        }
+        live.add(sched.commit(tx), count);
+      } else if (op == Op::remove) {
+        sched.removeTasks(live.take(1 + rng() % maxBatch, &rng));
+      } else {
+        sched.assignAlgo(static_cast<SchedulingAlgo>(rng() % 3));
+      }
+      pending.push_back({op, issued, sched.fence()});
+      harvest(pending, lat, false);
+      slot += interval;
+    }
+    harvest(pending, lat, true);
+    std::lock_guard lk(mergeMTX);
+    total.merge(lat);
+  };
+
+  auto replay = [&]() {
+    Latencies lat;
+    std::deque<Pending> pending;
+    for (const ScriptLine &s : *script) {
+      auto slot = start + s.at;
+      std::this_thread::sleep_until(slot);
+      auto issued = Clock::now();
+      if (issued - slot > std::chrono::milliseconds(1)) {
+        lat.late++;
+      }
+      if (s.op == Op::add) {
+        live.add(sched.commit(Transaction{}.add(s.adds)),
+                 static_cast<int>(s.adds.size()));
+      } else if (s.op == Op::remove) {
+        sched.removeTasks(live.take(s.count, nullptr));
+      } else {
+        sched.assignAlgo(s.algo);
+      }
+      pending.push_back({s.op, issued, sched.fence()});
+      harvest(pending, lat, false);
+    }
+    harvest(pending, lat, true);
+    std::lock_guard lk(mergeMTX);
+    total.merge(lat);
+  };
+
+  // The probe fences an otherwise idle interface: its latency is how long
+  // the scheduler thread takes to notice a wake-up, i.e. loop stalls.
+  std::vector<double> probes;
+  std::jthread probeT([&]() {
+    auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::milli>(probeMs));
+    while (!done) {
+      auto issued = Clock::now();
+      auto applied = sched.fence();
+      if (applied.wait_for(std::chrono::seconds(5)) !=
+          std::future_status::ready) {
+        probes.push_back(5e6);
+        continue;
+      }
+      probes.push_back(
+          std::chrono::duration<double, std::micro>(applied.get() - issued)
+              .count());
+      std::this_thread::sleep_for(interval);
+    }
+  });
+
+  {
+    std::vector<std::jthread> workers;
+    if (script) {
+      workers.emplace_back(replay);
+    } else {
+      for (int i = 0; i < threads; i++) {
+        workers.emplace_back(worker, i);
+      }
+    }
+  }
+  done = true;
+  probeT.join();
+  double elapsed =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  sched.stop();
+  schedT.join();
+
+  std::uint64_t ops = 0;
+  std::printf("commands   ");
+  for (int i = 0; i < opKinds; i++) {
+    ops += total.of[i].size();
+    std::printf(" %s %zu", opNames[i], total.of[i].size());
+  }
+  std::printf("\nthroughput %.1f commands/s over %.2fs, %llu issued late, "
+              "%zu tasks live, %llu events\n",
+              ops / elapsed, elapsed,
+              static_cast<unsigned long long>(total.late), live.size(),
+              static_cast<unsigned long long>(events.load()));
+  std::printf("%-8s %8s %10s %10s %10s %10s\n", "us", "count", "p50", "p99",
+              "p99.9", "max");
+  for (int i = 0; i < opKinds; i++) {
+    printRow(opNames[i], total.of[i]);
+  }
+  long stalls = std::ranges::count_if(
+      probes, [&](double us) { return us > stallMs * 1000; });
+  printRow("probe", probes);
+  std::printf("stalls over %.1fms: %ld of %zu probes\n", stallMs, stalls,
+              probes.size());
+  return 0;
+}
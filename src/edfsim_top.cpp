@@ -0,0 +1,96 @@
+// edfsim_top.cpp - live reader for the scheduler's shared-memory metrics
+#include "metrics.hpp"
+#include "process.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+void printHist(const char *label, const std::uint64_t (&hist)[latencyBuckets]) {
+  std::printf("%-10s", label);
+  for (int b = 0; b < latencyBuckets; b++) {
+    std::printf(" %6llu", static_cast<unsigned long long>(hist[b]));
+  }
+  std::printf("\n");
+}
+
+void print(const MetricsData &m) {
+  std::printf("uptime %10.3fs  algo %s  tasks %u  queue %u  runner %s\n",
+              m.updatedAt / 1e9,
+              algoName(static_cast<SchedulingAlgo>(m.algo)), m.taskCount,
+              m.queueDepth,
+              m.runner < 0 ? "idle" : std::to_string(m.runner).c_str());
+  std::printf("released %llu  started %llu  completed %llu  preempted %llu  "
+              "missed %llu  overhead %.3fms\n",
+              static_cast<unsigned long long>(m.released),
+              static_cast<unsigned long long>(m.started),
+              static_cast<unsigned long long>(m.completed),
+              static_cast<unsigned long long>(m.preempted),
+              static_cast<unsigned long long>(m.missed), m.overheadUs / 1e3);
+  std::printf("%-10s", "ms <");
+  for (int b = 0; b < latencyBuckets - 1; b++) {
+    std::printf(" %6llu", 1ULL << b);
+  }
+  std::printf("    inf\n");
+  printHist("response", m.responseHist);
+  printHist("dispatch", m.dispatchHist);
+  if (m.aperiodicCompleted) {
+    std::printf("aperiodic %llu  p50 %.3fms  p95 %.3fms  p99 %.3fms\n",
+                static_cast<unsigned long long>(m.aperiodicCompleted),
+                m.aperiodicP50Us / 1e3, m.aperiodicP95Us / 1e3,
+                m.aperiodicP99Us / 1e3);
+  }
+  if (m.inversions) {
+    std::printf("inversions %llu  blocked %.3fms\n",
+                static_cast<unsigned long long>(m.inversions),
+                m.blockedUs / 1e3);
+  }
+  std::printf("speed %.3f  energy %.3fs at full power\n",
+              m.speedPermille / 1e3, m.energyUs / 1e6);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string name = defaultMetricsName;
+  bool once = false;
+  long intervalMs = 500;
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    if (arg == "--once") {
+      once = true;
+    } else if (arg == "--interval" && i + 1 < argc) {
+      intervalMs = std::stol(argv[++i]);
+    } else if (arg == "--help") {
+      std::cout << "usage: edfsim-top [--once] [--interval ms] [segment]\n";
+      return 0;
+    } else {
+      name = arg;
+    }
+  }
+
+  MetricsReader reader(name);
+  if (!reader.ok()) {
+    std::cerr << "edfsim-top: cannot open segment " << name << std::endl;
+    return 1;
+  }
+  while (true) {
+    auto data = reader.read();
+    if (!data) {
+      std::cerr << "edfsim-top: segment " << name
+                << " has an incompatible layout" << std::endl;
+      return 1;
+    }
+    if (!once) {
+      std::printf("\033[H\033[2J");
+    }
+    print(*data);
+    std::fflush(stdout);
+    if (once) {
+      return 0;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+  }
+}
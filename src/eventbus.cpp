@@ -0,0 +1,248 @@
+#include "eventbus.hpp"
+#include <algorithm>
+#include <charconv>
+#include <system_error>
+#include <utility>
+
+namespace {
+constexpr EventType eventTypes[] = {
+    EventType::start,   EventType::complete,   EventType::preempt,
+    EventType::missed,  EventType::initialize, EventType::restart,
+    EventType::block,   EventType::unblock};
+
+std::uint32_t typeBit(EventType type) {
+  return 1u << static_cast<int>(type);
+}
+} // namespace
+
+bool EventFilter::accepts(const Event &e) const {
+  return (types & typeBit(e.type)) && (tasks.empty() || tasks.contains(e.id));
+}
+
+const char *eventName(EventType type) {
+  switch (type) {
+  case EventType::start:
+    return "start";
+  case EventType::complete:
+    return "complete";
+  case EventType::preempt:
+    return "preempt";
+  case EventType::missed:
+    return "missed";
+  case EventType::initialize:
+    return "initialize";
+  case EventType::restart:
+    return "restart";
+  case EventType::block:
+    return "block";
+  case EventType::unblock:
+    return "unblock";
+  }
+  return "?";
+}
+
+std::optional<EventFilter> parseEventFilter(std::string_view spec) {
+  EventFilter filter;
+  auto at = spec.find('@');
+  std::string_view types = spec.substr(0, at);
+  if (!types.empty() && types != "all") {
+    filter.types = 0;
+    while (!types.empty()) {
+      auto comma = types.find(',');
+      std::string_view name = types.substr(0, comma);
+      std::uint32_t bit = 0;
+      for (EventType type : eventTypes) {
+        if (name == eventName(type)) {
+          bit = typeBit(type);
+        }
+      }
+      if (!bit) {
+        return std::nullopt;
+      }
+      filter.types |= bit;
+      types = comma == std::string_view::npos ? std::string_view{}
+                                              : types.substr(comma + 1);
+    }
+  }
+  std::string_view tasks =
+      at == std::string_view::npos ? std::string_view{} : spec.substr(at + 1);
+  while (!tasks.empty()) {
+    auto comma = tasks.find(',');
+    std::string_view number = tasks.substr(0, comma);
+    int id;
+    auto [end, ec] =
+        std::from_chars(number.data(), number.data() + number.size(), id);
+    if (ec != std::errc{} || end != number.data() + number.size() || id < 0) {
+      return std::nullopt;
+    }
+    filter.tasks.insert(id);
+    tasks = comma == std::string_view::npos ? std::string_view{}
+                                            : tasks.substr(comma + 1);
+  }
+  return filter;
+}
+
+EventBus::EventBus(std::size_t chunkSize, std::size_t retainedChunks)
+    : chunkSize(std::max<std::size_t>(chunkSize, 1)),
+      retainedChunks(std::max<std::size_t>(retainedChunks, 1)) {}
+
+EventBus::~EventBus() {
+  std::map<int, std::unique_ptr<Subscriber>> leaving;
+  {
+    std::lock_guard openLk(openMTX);
+    seal();
+    std::lock_guard lk(busMTX);
+    for (auto &[id, s] : subscribers) {
+      s->stopping = true;
+    }
+    leaving = std::move(subscribers);
+    active = 0;
+  }
+  CV.notify_all();
+  for (auto &[id, s] : leaving) {
+    s->thread.join();
+  }
+}
+
+// Moves the open events, if any, into a chunk; openMTX must be held.
+bool EventBus::seal() {
+  if (open.empty()) {
+    return false;
+  }
+  std::vector<Event> events;
+  events.reserve(chunkSize);
+  std::swap(events, open);
+  std::lock_guard lk(busMTX);
+  std::size_t count = events.size();
+  chunks.push_back(
+      std::make_shared<const Chunk>(Chunk{sealed, std::move(events)}));
+  sealed += count;
+  if (chunks.size() > retainedChunks) {
+    chunks.pop_front();
+    firstChunk++;
+  }
+  return true;
+}
+
+void EventBus::publish(const Event &e) {
+  if (active.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  {
+    std::lock_guard lk(openMTX);
+    open.push_back(e);
+    if (open.size() < chunkSize) {
+      return;
+    }
+    seal();
+  }
+  CV.notify_all();
+}
+
+int EventBus::subscribe(EventFilter filter, std::size_t batchSize,
+                        Consumer consume, std::chrono::milliseconds maxDelay) {
+  std::lock_guard openLk(openMTX);
+  std::lock_guard lk(busMTX);
+  int id = nextId++;
+  auto s = std::make_unique<Subscriber>(Subscriber{
+      std::move(filter), std::max<std::size_t>(batchSize, 1), maxDelay,
+      std::move(consume), firstChunk + chunks.size(), sealed});
+  Subscriber &ref = *s;
+  ref.thread = std::jthread([this, &ref]() { run(ref); });
+  subscribers.emplace(id, std::move(s));
+  active++;
+  return id;
+}
+
+void EventBus::unsubscribe(int id) {
+  std::unique_ptr<Subscriber> leaving;
+  {
+    std::lock_guard openLk(openMTX);
+    seal();
+    std::lock_guard lk(busMTX);
+    auto it = subscribers.find(id);
+    if (it == subscribers.end()) {
+      return;
+    }
+    it->second->stopping = true;
+    leaving = std::move(it->second);
+    subscribers.erase(it);
+    active--;
+  }
+  CV.notify_all();
+  leaving->thread.join();
+}
+
+std::optional<std::uint64_t> EventBus::dropped(int id) {
+  std::lock_guard lk(busMTX);
+  auto it = subscribers.find(id);
+  if (it == subscribers.end()) {
+    return std::nullopt;
+  }
+  return it->second->dropped;
+}
+
+// A subscriber's thread: takes one chunk at a time under the lock and
+// filters and delivers it outside. When no chunk comes for maxDelay, it
+// seals the open events itself, so a quiet producer is not left holding
+// them.
+void EventBus::run(Subscriber &s) {
+  std::vector<Event> batch;
+  std::chrono::steady_clock::time_point batchSince;
+  while (true) {
+    std::shared_ptr<const Chunk> chunk;
+    bool stopping;
+    bool idle;
+    {
+      std::unique_lock lk(busMTX);
+      idle = !CV.wait_for(lk, s.maxDelay, [&]() {
+        return s.stopping || s.cursor < firstChunk + chunks.size();
+      });
+    }
+    if (idle) {
+      std::unique_lock openLk(openMTX);
+      if (seal()) {
+        openLk.unlock();
+        CV.notify_all();
+      }
+    }
+    {
+      std::lock_guard lk(busMTX);
+      if (s.cursor < firstChunk) {
+        s.dropped += chunks.front()->first - s.seen;
+        s.seen = chunks.front()->first;
+        s.cursor = firstChunk;
+      }
+      if (s.cursor < firstChunk + chunks.size()) {
+        chunk = chunks[s.cursor - firstChunk];
+        s.cursor++;
+        s.seen = chunk->first + chunk->events.size();
+      }
+      stopping = s.stopping;
+    }
+    if (chunk) {
+      for (const Event &e : chunk->events) {
+        if (!s.filter.accepts(e)) {
+          continue;
+        }
+        if (batch.empty()) {
+          batchSince = std::chrono::steady_clock::now();
+        }
+        batch.push_back(e);
+      }
+      std::size_t whole = batch.size() / s.batchSize * s.batchSize;
+      for (std::size_t i = 0; i < whole; i += s.batchSize) {
+        s.consume(std::span<const Event>(batch.data() + i, s.batchSize));
+      }
+      batch.erase(batch.begin(), batch.begin() + whole);
+    }
+    bool late = std::chrono::steady_clock::now() - batchSince >= s.maxDelay;
+    if (!batch.empty() && (late || (!chunk && stopping))) {
+      s.consume(batch);
+      batch.clear();
+    }
+    if (!chunk && stopping) {
+      break;
+    }
+  }
+}
@@ -0,0 +1,101 @@
+// eventbus.hpp - scheduler events fanned out to batched subscriber threads
+#pragma once
+
+#include "process.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Which events a subscriber gets: a bit per EventType, and the tasks it
+// cares about, all of them if empty.
+struct EventFilter {
+  std::uint32_t types = ~0u;
+  std::set<int> tasks;
+
+  bool accepts(const Event &e) const;
+};
+
+const char *eventName(EventType type);
+// Parses <type>,<type>,...[@<task>,<task>,...]; "all" or an empty type
+// list takes every type.
+std::optional<EventFilter> parseEventFilter(std::string_view spec);
+
+// One producer appends to a shared log of fixed-size chunks; subscribers
+// each run their own thread with their own cursor into it, so publishing
+// costs the same however many are attached. Only the newest chunks are
+// kept: a subscriber falling further behind skips to the oldest one still
+// there and counts what it missed, instead of holding the producer back.
+class EventBus {
+public:
+  using Consumer = std::function<void(std::span<const Event>)>;
+
+private:
+  struct Chunk {
+    // Sequence number of the first event
+    std::uint64_t first;
+    std::vector<Event> events;
+  };
+  struct Subscriber {
+    EventFilter filter;
+    std::size_t batchSize;
+    std::chrono::milliseconds maxDelay;
+    Consumer consume;
+    // Next chunk to read, and the sequence number of the next event
+    std::uint64_t cursor;
+    std::uint64_t seen;
+    std::uint64_t dropped = 0;
+    bool stopping = false;
+    std::jthread thread;
+  };
+  std::size_t chunkSize;
+  std::size_t retainedChunks;
+  // The producer only takes openMTX per event, and busMTX once per chunk,
+  // so subscribers woken by a chunk do not contend with it. Lock order is
+  // openMTX, then busMTX.
+  std::mutex openMTX;
+  std::vector<Event> open;
+  std::mutex busMTX;
+  std::condition_variable CV;
+  std::deque<std::shared_ptr<const Chunk>> chunks;
+  // Sequence number of chunks.front()
+  std::uint64_t firstChunk = 0;
+  // Events sealed into chunks so far
+  std::uint64_t sealed = 0;
+  std::map<int, std::unique_ptr<Subscriber>> subscribers;
+  std::atomic<int> active = 0;
+  int nextId = 0;
+
+  bool seal();
+  void run(Subscriber &s);
+
+public:
+  explicit EventBus(std::size_t chunkSize = 256,
+                    std::size_t retainedChunks = 256);
+  EventBus(const EventBus &) = delete;
+  EventBus &operator=(const EventBus &) = delete;
+  // Delivers what is still queued, then joins every subscriber.
+  ~EventBus();
+  // consume gets the matching events in order, batchSize at a time, or
+  // fewer once the oldest has waited about maxDelay. Starts with the events
+  // not yet handed to any subscriber.
+  int subscribe(EventFilter filter, std::size_t batchSize, Consumer consume,
+                std::chrono::milliseconds maxDelay =
+                    std::chrono::milliseconds(100));
+  // Delivers what the subscriber has pending and joins its thread.
+  void unsubscribe(int id);
+  std::optional<std::uint64_t> dropped(int id);
+  void publish(const Event &e);
+};
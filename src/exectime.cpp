@@ -0,0 +1,119 @@
+#include "exectime.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+namespace {
+// Uniform in [0, 1) from the top 53 bits, so that a seeded run samples the
+// same values with every standard library.
+double unitDraw(std::mt19937_64 &rng) {
+  return static_cast<double>(rng() >> 11) * 0x1.0p-53;
+}
+
+template <typename T> bool parseNumber(std::string_view text, T &value) {
+  while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+    text.remove_prefix(1);
+  }
+  while (!text.empty() &&
+         (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+    text.remove_suffix(1);
+  }
+  const char *end = text.data() + text.size();
+  auto [ptr, ec] = std::from_chars(text.data(), end, value);
+  return ec == std::errc{} && ptr == end;
+}
+} // namespace
+
+std::chrono::milliseconds
+ExecutionTime::sample(std::mt19937_64 &rng,
+                      std::chrono::milliseconds wcet) const {
+  switch (kind) {
+  case ExecutionKind::uniform: {
+    double factor = low + (high - low) * unitDraw(rng);
+    return std::chrono::milliseconds(
+        std::max(1L, std::lround(factor * wcet.count())));
+  }
+  case ExecutionKind::histogram: {
+    if (!histogram || histogram->values.empty()) {
+      break;
+    }
+    double draw = unitDraw(rng) * histogram->cumulative.back();
+    auto it = std::ranges::upper_bound(histogram->cumulative, draw);
+    std::size_t i = std::min<std::size_t>(it - histogram->cumulative.begin(),
+                                          histogram->values.size() - 1);
+    return std::chrono::milliseconds(histogram->values[i]);
+  }
+  case ExecutionKind::fixed:
+    break;
+  }
+  return wcet;
+}
+
+std::optional<Histogram> loadHistogram(const std::filesystem::path &path) {
+  std::ifstream in(path);
+  if (!in) {
+    return std::nullopt;
+  }
+  Histogram result;
+  double total = 0;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::string_view row = line;
+    auto first = row.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos || row[first] == '#') {
+      continue;
+    }
+    auto comma = row.find(',');
+    long value;
+    double weight = 1;
+    if (!parseNumber(row.substr(0, comma), value) || value <= 0 ||
+        (comma != std::string_view::npos &&
+         !parseNumber(row.substr(comma + 1), weight)) ||
+        weight < 0) {
+      return std::nullopt;
+    }
+    total += weight;
+    result.values.push_back(value);
+    result.cumulative.push_back(total);
+  }
+  if (total <= 0) {
+    return std::nullopt;
+  }
+  return result;
+}
+
+std::optional<ExecutionTime> parseExecutionTime(std::string_view spec) {
+  auto colon = spec.find(':');
+  std::string_view kind = spec.substr(0, colon);
+  std::string_view rest = colon == std::string_view::npos
+                              ? std::string_view{}
+                              : spec.substr(colon + 1);
+  ExecutionTime model;
+  if (kind == "fixed") {
+    return model;
+  }
+  if (kind == "uniform") {
+    auto second = rest.find(':');
+    if (second == std::string_view::npos ||
+        !parseNumber(rest.substr(0, second), model.low) ||
+        !parseNumber(rest.substr(second + 1), model.high) || model.low <= 0 ||
+        model.high < model.low) {
+      return std::nullopt;
+    }
+    model.kind = ExecutionKind::uniform;
+    return model;
+  }
+  if (kind == "hist") {
+    auto histogram = loadHistogram(std::filesystem::path(rest));
+    if (!histogram) {
+      return std::nullopt;
+    }
+    model.kind = ExecutionKind::histogram;
+    model.histogram = std::make_shared<const Histogram>(std::move(*histogram));
+    return model;
+  }
+  return std::nullopt;
+}
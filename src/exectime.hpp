@@ -0,0 +1,43 @@
+// exectime.hpp - per-task execution time distributions
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <vector>
+
+// Empirical execution times in ms with their relative weights, stored as a
+// cumulative distribution.
+struct Histogram {
+  std::vector<long> values;
+  std::vector<double> cumulative;
+};
+
+enum class ExecutionKind { fixed = 0, uniform, histogram };
+
+// How long each job of a task actually runs, sampled at every release. A
+// task's duration stays its worst-case budget: fixed always runs exactly
+// that, uniform draws from [low, high] times it, and histogram draws from
+// measured times regardless of it.
+struct ExecutionTime {
+  ExecutionKind kind = ExecutionKind::fixed;
+  double low = 1;
+  double high = 1;
+  std::shared_ptr<const Histogram> histogram;
+
+  bool fixed() const { return kind == ExecutionKind::fixed; }
+  std::chrono::milliseconds sample(std::mt19937_64 &rng,
+                                   std::chrono::milliseconds wcet) const;
+};
+
+// One "value[,weight]" row per line, values in ms and weights defaulting to
+// 1; blank lines and lines starting with '#' are skipped. Returns nullopt if
+// the file cannot be read, a row is malformed or no weight is positive.
+std::optional<Histogram> loadHistogram(const std::filesystem::path &path);
+
+// Parses fixed, uniform:<low>:<high> or hist:<path>.
+std::optional<ExecutionTime> parseExecutionTime(std::string_view spec);
@@ -0,0 +1,137 @@
+#include "executor.hpp"
+#include <chrono>
+#include <mutex>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+Executor::Executor(std::function<void(int, std::uint64_t,
+                                      std::chrono::steady_clock::duration)>
+                       onComplete,
+                   int cpu)
+    : cpu(cpu), onComplete(onComplete) {}
+
+Executor::~Executor() {
+  for (auto &[id, w] : workers) {
+    {
+      std::lock_guard lk(w->mtx);
+      w->stopping = true;
+    }
+    w->CV.notify_all();
+  }
+  workers.clear();
+}
+
+void Executor::bind(int id, Workload body) {
+  unbind(id);
+  auto w = std::make_unique<Worker>();
+  w->id = id;
+  w->body = std::move(body);
+  Worker &worker = *w;
+  w->thread = std::jthread([this, &worker]() { this->work(worker); });
+  workers.emplace(id, std::move(w));
+}
+
+void Executor::unbind(int id) {
+  auto it = workers.find(id);
+  if (it == workers.end()) {
+    return;
+  }
+  {
+    std::lock_guard lk(it->second->mtx);
+    it->second->stopping = true;
+  }
+  it->second->CV.notify_all();
+  workers.erase(it);
+}
+
+bool Executor::bound(int id) const { return workers.contains(id); }
+
+void Executor::release(int id, std::uint64_t job) {
+  auto it = workers.find(id);
+  if (it == workers.end()) {
+    return;
+  }
+  {
+    std::lock_guard lk(it->second->mtx);
+    it->second->released = job;
+    it->second->allowed = false;
+  }
+  it->second->CV.notify_all();
+}
+
+void Executor::dispatch(int id) {
+  auto it = workers.find(id);
+  if (it == workers.end()) {
+    return;
+  }
+  {
+    std::lock_guard lk(it->second->mtx);
+    it->second->allowed = true;
+  }
+  it->second->CV.notify_all();
+}
+
+void Executor::preempt(int id) {
+  auto it = workers.find(id);
+  if (it == workers.end()) {
+    return;
+  }
+  std::lock_guard lk(it->second->mtx);
+  it->second->allowed = false;
+}
+
+void Executor::work(Worker &w) {
+#if defined(__linux__)
+  if (cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+#endif
+  while (true) {
+    std::uint64_t job;
+    {
+      std::unique_lock lk(w.mtx);
+      w.CV.wait(lk, [&w]() {
+        return w.stopping || (w.released > w.started && w.allowed);
+      });
+      if (w.stopping) {
+        return;
+      }
+      job = w.started = w.released;
+    }
+    JobContext ctx(w, job);
+    try {
+      w.body(ctx);
+    } catch (const JobCancelled &) {
+      continue;
+    }
+    onComplete(w.id, job, ctx.elapsed());
+  }
+}
+
+JobContext::JobContext(Executor::Worker &worker, std::uint64_t job)
+    : worker(worker), job(job), sliceStart(std::chrono::steady_clock::now()) {}
+
+void JobContext::yield() {
+  std::unique_lock lk(worker.mtx);
+  if (worker.allowed && worker.released == job && !worker.stopping) {
+    return;
+  }
+  executed += std::chrono::steady_clock::now() - sliceStart;
+  worker.CV.wait(lk, [this]() {
+    return worker.stopping || worker.released != job || worker.allowed;
+  });
+  if (worker.stopping || worker.released != job) {
+    throw JobCancelled{};
+  }
+  sliceStart = std::chrono::steady_clock::now();
+}
+
+std::chrono::steady_clock::duration JobContext::elapsed() const {
+  return executed + (std::chrono::steady_clock::now() - sliceStart);
+}
@@ -0,0 +1,71 @@
+// executor.hpp - runs task workloads on pinned worker threads
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class JobContext;
+using Workload = std::function<void(JobContext &)>;
+
+// Thrown out of JobContext::yield when the job was superseded by a new
+// release or its worker is shutting down. Workloads must let it propagate.
+struct JobCancelled {};
+
+class Executor {
+  struct Worker {
+    int id;
+    Workload body;
+    std::mutex mtx;
+    std::condition_variable CV;
+    std::uint64_t released = 0;
+    std::uint64_t started = 0;
+    bool allowed = false;
+    bool stopping = false;
+    std::jthread thread;
+  };
+
+  int cpu;
+  std::map<int, std::unique_ptr<Worker>> workers;
+  std::function<void(int, std::uint64_t, std::chrono::steady_clock::duration)>
+      onComplete;
+
+  void work(Worker &w);
+  friend class JobContext;
+
+public:
+  Executor(std::function<void(int, std::uint64_t,
+                              std::chrono::steady_clock::duration)>
+               onComplete,
+           int cpu = 0);
+  Executor(const Executor &) = delete;
+  Executor &operator=(const Executor &) = delete;
+  ~Executor();
+  void bind(int id, Workload body);
+  void unbind(int id);
+  bool bound(int id) const;
+  void release(int id, std::uint64_t job);
+  void dispatch(int id);
+  void preempt(int id);
+};
+
+class JobContext {
+  Executor::Worker &worker;
+  std::uint64_t job;
+  std::chrono::steady_clock::duration executed{};
+  std::chrono::steady_clock::time_point sliceStart;
+
+  JobContext(Executor::Worker &worker, std::uint64_t job);
+  friend class Executor;
+
+public:
+  // Cooperative preemption point: blocks while the scheduler has preempted
+  // this job and throws JobCancelled if the job has been superseded.
+  void yield();
+  std::chrono::steady_clock::duration elapsed() const;
+};
@@ -0,0 +1,120 @@
+#include "frameprofiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <raylib.h>
+#include <string>
+
+namespace {
+constexpr std::array<const char *, frameStages> stageNames = {
+    "View::advanceState", "TimeLine::drawTimeLine", "TimeLine::drawLogs",
+    "TraySection::draw", "Controls::draw"};
+
+std::string ms(double value) {
+  char text[16];
+  std::snprintf(text, sizeof(text), "%.2f", value);
+  return text;
+}
+
+double millis(std::chrono::steady_clock::duration span) {
+  return std::chrono::duration<double, std::milli>(span).count();
+}
+} // namespace
+
+FrameProfiler::Scope::Scope(FrameProfiler &profiler, FrameStage stage)
+    : profiler(profiler), stage(stage), start(clock::now()) {}
+
+FrameProfiler::Scope::~Scope() {
+  profiler.current.stageMs[static_cast<int>(stage)] +=
+      millis(clock::now() - start);
+}
+
+void FrameProfiler::beginFrame() {
+  auto now = clock::now();
+  if (frameStart) {
+    current.totalMs = millis(now - *frameStart);
+    if (history.size() < historySize) {
+      history.push_back(current);
+    } else {
+      history[next] = current;
+    }
+    next = (next + 1) % historySize;
+  }
+  current = {};
+  frameStart = now;
+}
+
+std::unique_lock<std::mutex> FrameProfiler::lock(std::mutex &m) {
+  auto start = clock::now();
+  std::unique_lock lk(m);
+  current.lockWaitMs += millis(clock::now() - start);
+  return lk;
+}
+
+// Stage and lock times are averaged over the whole history, with the worst
+// frame next to them; events and draws are those of the last frame.
+void FrameProfiler::draw() {
+  if (!shown || history.empty()) {
+    return;
+  }
+  std::vector<double> totals;
+  totals.reserve(history.size());
+  std::array<double, frameStages> stageSum{};
+  std::array<double, frameStages> stageMax{};
+  double lockSum = 0;
+  double lockMax = 0;
+  for (const Frame &frame : history) {
+    totals.push_back(frame.totalMs);
+    for (int i = 0; i < frameStages; i++) {
+      stageSum[i] += frame.stageMs[i];
+      stageMax[i] = std::max(stageMax[i], frame.stageMs[i]);
+    }
+    lockSum += frame.lockWaitMs;
+    lockMax = std::max(lockMax, frame.lockWaitMs);
+  }
+  std::ranges::sort(totals);
+  double p50 = totals[totals.size() / 2];
+  double p99 = totals[totals.size() * 99 / 100];
+  double n = static_cast<double>(history.size());
+  const Frame &last = history[(next + historySize - 1) % historySize];
+
+  const int x = 10;
+  const int y = 10;
+  const int width = 2 * static_cast<int>(historySize) + 20;
+  const int graphHeight = 80;
+  DrawRectangle(x, y, width, 270, {20, 22, 28, 225});
+  int line = y + 8;
+  auto text = [&](const std::string &s) {
+    DrawText(s.c_str(), x + 10, line, 14, WHITE);
+    line += 17;
+  };
+  text("frame p50 " + ms(p50) + "ms  p99 " + ms(p99) + "ms  (" +
+       std::to_string(history.size()) + " frames, F3 hides)");
+  for (int i = 0; i < frameStages; i++) {
+    text(std::string(stageNames[i]) + "  " + ms(stageSum[i] / n) + "  max " +
+         ms(stageMax[i]));
+  }
+  text("eventMTX/APMTX wait  " + ms(lockSum / n) + "  max " + ms(lockMax));
+  text("events " + std::to_string(last.events) + "  draws " +
+       std::to_string(last.draws));
+
+  // One bar per frame, oldest on the left, scaled so p99 sits at 3/4.
+  int base = y + 270 - 10;
+  double scale = graphHeight * 0.75 / std::max(p99, 1.0);
+  for (std::size_t i = 0; i < history.size(); i++) {
+    const Frame &frame =
+        history[history.size() < historySize ? i : (next + i) % historySize];
+    int barHeight = std::min(
+        graphHeight, static_cast<int>(frame.totalMs * scale + 0.5));
+    DrawRectangle(x + 10 + 2 * static_cast<int>(i), base - barHeight, 2,
+                  barHeight, frame.totalMs > p99 ? RED : GREEN);
+  }
+  for (auto [value, color] : {std::pair{p50, SKYBLUE}, {p99, ORANGE}}) {
+    int level = base - static_cast<int>(value * scale + 0.5);
+    DrawLine(x + 10, level, x + width - 10, level, color);
+  }
+}
+
+FrameProfiler &frameProfiler() {
+  static FrameProfiler profiler;
+  return profiler;
+}
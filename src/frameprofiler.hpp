@@ -0,0 +1,74 @@
+// frameprofiler.hpp - per-stage timing of the render thread, drawn as a HUD
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+enum class FrameStage {
+  advanceState = 0,
+  drawTimeLine,
+  drawLogs,
+  trayDraw,
+  controlsDraw
+};
+constexpr int frameStages = 5;
+
+// Samples every frame whether shown or not, so the graph is already full
+// when the overlay is toggled on. Only the render thread may touch it.
+class FrameProfiler {
+  using clock = std::chrono::steady_clock;
+  struct Frame {
+    double totalMs = 0;
+    std::array<double, frameStages> stageMs{};
+    double lockWaitMs = 0;
+    long draws = 0;
+    std::size_t events = 0;
+  };
+  static constexpr std::size_t historySize = 200;
+  std::vector<Frame> history;
+  std::size_t next = 0;
+  Frame current;
+  std::optional<clock::time_point> frameStart;
+  bool shown = false;
+
+public:
+  class Scope {
+    FrameProfiler &profiler;
+    FrameStage stage;
+    clock::time_point start;
+
+  public:
+    Scope(FrameProfiler &profiler, FrameStage stage);
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+    ~Scope();
+  };
+
+  // Closes the previous frame, which spans from one call to the next, so
+  // the frame time includes presenting and waiting for vsync.
+  void beginFrame();
+  Scope measure(FrameStage stage) { return Scope(*this, stage); }
+  // Locks m, adding the time spent waiting to the frame.
+  std::unique_lock<std::mutex> lock(std::mutex &m);
+  void countDraws(long n) { current.draws += n; }
+  void countEvents(std::size_t n) { current.events += n; }
+  void toggle() { shown = !shown; }
+  void draw();
+};
+
+// The render thread's profiler.
+FrameProfiler &frameProfiler();
+
+// Calls a raylib Draw* function and counts it toward the frame's draw
+// calls, so the count follows the drawing code. The overlay's own drawing
+// is left out.
+template <typename... Params>
+void counted(void (*draw)(Params...), std::type_identity_t<Params>... args) {
+  frameProfiler().countDraws(1);
+  draw(args...);
+}
@@ -0,0 +1,135 @@
+#include "host.hpp"
+#include <algorithm>
+#include <mutex>
+
+SchedulerHost::SchedulerHost(unsigned threads) {
+  threads = std::max(threads, 1u);
+  for (unsigned i = 0; i < threads; i++) {
+    pool.emplace_back([this]() { this->work(); });
+  }
+}
+
+SchedulerHost::~SchedulerHost() {
+  {
+    std::lock_guard lk(hostMTX);
+    stopping = true;
+  }
+  CV.notify_all();
+  pool.clear();
+  // No pool thread is left, so nothing polls or wakes through us any more.
+  for (auto &[id, slot] : slots) {
+    slot.sched->host = nullptr;
+  }
+  slots.clear();
+}
+
+Scheduler &SchedulerHost::add(SchedulingAlgo algo,
+                              std::function<void(Event)> interface) {
+  auto sched = std::make_unique<Scheduler>(algo, std::move(interface));
+  Scheduler &ref = *sched;
+  {
+    std::lock_guard lk(hostMTX);
+    std::uint64_t id = nextSlot++;
+    ref.hostSlot = id;
+    ref.host = this;
+    Slot &slot = slots[id];
+    slot.sched = std::move(sched);
+    arm(id, slot, std::chrono::steady_clock::now());
+  }
+  CV.notify_one();
+  return ref;
+}
+
+// Waits for an ongoing poll of the instance to return before destroying it.
+void SchedulerHost::remove(Scheduler &sched) {
+  std::unique_ptr<Scheduler> removed;
+  {
+    std::unique_lock lk(hostMTX);
+    auto it = slots.find(sched.hostSlot);
+    if (it == slots.end() || it->second.sched.get() != &sched) {
+      return;
+    }
+    sched.running = false;
+    idleCV.wait(lk, [&it]() { return !it->second.polling; });
+    sched.host = nullptr;
+    removed = std::move(it->second.sched);
+    slots.erase(it);
+  }
+}
+
+std::size_t SchedulerHost::size() {
+  std::lock_guard lk(hostMTX);
+  return slots.size();
+}
+
+// Called with hostMTX held. Timer entries are never removed; an entry whose
+// time no longer matches its slot's due time is stale and skipped.
+void SchedulerHost::arm(std::uint64_t id, Slot &slot,
+                        std::chrono::steady_clock::time_point due) {
+  slot.due = due;
+  if (due != std::chrono::steady_clock::time_point::max()) {
+    timers.emplace(due, id);
+  }
+}
+
+void SchedulerHost::wake(std::uint64_t id) {
+  {
+    std::lock_guard lk(hostMTX);
+    auto it = slots.find(id);
+    if (it == slots.end()) {
+      return;
+    }
+    Slot &slot = it->second;
+    if (slot.polling) {
+      slot.rewake = true;
+      return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (slot.due <= now) {
+      return;
+    }
+    arm(id, slot, now);
+  }
+  CV.notify_one();
+}
+
+void SchedulerHost::work() {
+  std::unique_lock lk(hostMTX);
+  while (!stopping) {
+    if (timers.empty()) {
+      CV.wait(lk);
+      continue;
+    }
+    auto [due, id] = timers.top();
+    auto it = slots.find(id);
+    if (it == slots.end() || it->second.due != due || it->second.polling) {
+      timers.pop();
+      continue;
+    }
+    if (due > std::chrono::steady_clock::now()) {
+      CV.wait_until(lk, due);
+      continue;
+    }
+    timers.pop();
+    Slot &slot = it->second;
+    slot.polling = true;
+    slot.rewake = false;
+    Scheduler &sched = *slot.sched;
+    lk.unlock();
+    auto next = sched.poll();
+    lk.lock();
+    slot.polling = false;
+    if (slot.rewake) {
+      next = std::chrono::steady_clock::now();
+    }
+    if (sched.running) {
+      arm(id, slot, next);
+    } else {
+      slot.due = std::chrono::steady_clock::time_point::max();
+    }
+    idleCV.notify_all();
+    // Another thread may be sleeping on a later timer than the one just
+    // armed.
+    CV.notify_one();
+  }
+}
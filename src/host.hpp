@@ -0,0 +1,58 @@
+// host.hpp - runs many schedulers on a small shared thread pool
+#pragma once
+
+#include "process.hpp"
+#include "scheduler.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// Owns any number of schedulers and advances them with Scheduler::poll()
+// from a fixed pool of threads instead of one blocked thread each. All
+// instances share one timer queue ordered by their next wakeup; interface
+// calls on an instance move it to the front. An instance is only ever
+// polled by one thread at a time.
+class SchedulerHost {
+  struct Slot {
+    std::unique_ptr<Scheduler> sched;
+    std::chrono::steady_clock::time_point due;
+    bool polling = false;
+    bool rewake = false;
+  };
+  typedef std::tuple<std::chrono::steady_clock::time_point, std::uint64_t>
+      TimerEntry;
+
+  std::mutex hostMTX;
+  std::condition_variable CV;
+  std::condition_variable idleCV;
+  std::map<std::uint64_t, Slot> slots;
+  std::priority_queue<TimerEntry, std::vector<TimerEntry>, std::greater<>>
+      timers;
+  std::uint64_t nextSlot = 0;
+  bool stopping = false;
+  std::vector<std::jthread> pool;
+
+  void work();
+  void arm(std::uint64_t id, Slot &slot,
+           std::chrono::steady_clock::time_point due);
+  void wake(std::uint64_t id);
+  friend class Scheduler;
+
+public:
+  explicit SchedulerHost(unsigned threads = std::thread::hardware_concurrency());
+  SchedulerHost(const SchedulerHost &) = delete;
+  SchedulerHost &operator=(const SchedulerHost &) = delete;
+  ~SchedulerHost();
+  Scheduler &add(SchedulingAlgo algo = SchedulingAlgo::EDF,
+                 std::function<void(Event)> interface = {});
+  void remove(Scheduler &sched);
+  std::size_t size();
+};
@@ -1,7 +1,73 @@
+#include "analysis.hpp"
 #include "app.hpp"
+#include "metrics.hpp"
+#include "taskset.hpp"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <optional>
 #include <raylib.h>
+#include <string>
+#include <string_view>
 
-int main() {
+namespace {
+// Stand-in control-loop kernel: burns `work` of its own execution time and
+// offers a preemption point every few microseconds.
+Workload spinFor(std::chrono::milliseconds work) {
+  return [work](JobContext &ctx) {
+    volatile double acc = 0;
+    while (ctx.elapsed() < work) {
+      for (int i = 0; i < 1000; i++) {
+        acc = acc * 0.5 + i;
+      }
+      ctx.yield();
+    }
+  };
+}
+
+// Coroutine flavour of spinFor, driven by the scheduler thread itself.
+CoroJob spinCoroutine(PreemptionPoint point, std::chrono::milliseconds work) {
+  volatile double acc = 0;
+  while (point.elapsed() < work) {
+    for (int i = 0; i < 200; i++) {
+      acc = acc * 0.5 + i;
+    }
+    co_await point;
+  }
+}
+
+// Parses full, none, deferred:<ms> or points:<ms>.
+void parsePreemption(std::string_view spec, PreemptionModel &model) {
+  auto colon = spec.find(':');
+  std::string_view mode = spec.substr(0, colon);
+  if (colon != std::string_view::npos) {
+    model.quantum = std::chrono::milliseconds(
+        std::stol(std::string(spec.substr(colon + 1))));
+  }
+  if (mode == "none") {
+    model.mode = PreemptionMode::nonPreemptive;
+  } else if (mode == "deferred") {
+    model.mode = PreemptionMode::deferred;
+  } else if (mode == "points") {
+    model.mode = PreemptionMode::fixedPoints;
+  } else {
+    model.mode = PreemptionMode::full;
+  }
+}
+
+SlackPolicy parseSlackPolicy(std::string_view name) {
+  if (name == "none") {
+    return SlackPolicy::none;
+  }
+  if (name == "donate") {
+    return SlackPolicy::donate;
+  }
+  return SlackPolicy::reclaim;
+}
+} // namespace
+
+int main(int argc, char **argv) {
   int height = 800;
   int width = 1280;
   InitWindow(width, height, "Scheduling simulation");
@@ -9,13 +75,151 @@ int main() {
 
   App app(1280 * viewRatio, height);
 
-  std::vector<std::tuple<long, long, long>> paramVector = {{5000, 1000, 0},
-                                                           {6000, 800, 0},
-                                                           {4000, 400, 0},
-                                                           {5000, 660, 0},
-                                                           {2000, 300, 0}};
+  std::vector<TaskParams> paramVector = {{5000, 1000, 0},
+                                         {6000, 800, 0},
+                                         {4000, 400, 0},
+                                         {5000, 660, 0},
+                                         {2000, 300, 0}};
+
+  PreemptionModel preemption;
+  bool customPreemption = false;
+  bool execute = false;
+  bool coroutines = false;
+  bool perf = false;
+  bool deadlineMonotonic = false;
+  bool spread = false;
+  std::optional<std::filesystem::path> savePath;
+  std::optional<ExecutionTime> execTime;
+  std::optional<ServerSpec> server;
+  std::map<int, std::vector<CriticalSection>> sections;
+  std::optional<DvfsPolicy> dvfs;
+  PowerModel power;
+  std::optional<std::filesystem::path> logPath;
+  EventFilter logFilter;
+  // The compared schedulers must exist before any option is forwarded to
+  // them.
+  for (int i = 1; i < argc; i++) {
+    if (std::string_view(argv[i]) == "--compare") {
+      app.compare({SchedulingAlgo::RMS});
+    } else if (std::string_view(argv[i]) == "--compare-wcet") {
+      app.compare({SchedulingAlgo::EDF}, SlackPolicy::none);
+    }
+  }
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    if (arg == "--metrics") {
+      bool named = i + 1 < argc && argv[i + 1][0] == '/';
+      app.publishMetrics(named ? argv[++i] : defaultMetricsName);
+    } else if (arg == "--trace" && i + 1 < argc) {
+      app.traceTo(argv[++i]);
+    } else if (arg == "--log" && i + 1 < argc) {
+      logPath = argv[++i];
+    } else if (arg == "--log-filter" && i + 1 < argc) {
+      if (auto filter = parseEventFilter(argv[++i])) {
+        logFilter = *filter;
+      }
+    } else if (arg == "--table") {
+      app.useDispatchTable(true);
+    } else if (arg == "--coalesce" && i + 1 < argc) {
+      app.setCoalesceWindow(std::chrono::microseconds(std::stol(argv[++i])));
+    } else if (arg == "--preemption" && i + 1 < argc) {
+      parsePreemption(argv[++i], preemption);
+      customPreemption = true;
+    } else if (arg == "--switch-cost" && i + 1 < argc) {
+      preemption.contextSwitch = std::chrono::milliseconds(std::stol(argv[++i]));
+      customPreemption = true;
+    } else if (arg == "--refill-cost" && i + 1 < argc) {
+      preemption.cacheRefill = std::chrono::milliseconds(std::stol(argv[++i]));
+      customPreemption = true;
+    } else if (arg == "--execute") {
+      execute = true;
+    } else if (arg == "--coroutines") {
+      coroutines = true;
+    } else if (arg == "--load" && i + 1 < argc) {
+      if (auto loaded = loadTaskSet(argv[++i])) {
+        paramVector = std::move(*loaded);
+      }
+    } else if (arg == "--save" && i + 1 < argc) {
+      savePath = argv[++i];
+    } else if (arg == "--exec" && i + 1 < argc) {
+      execTime = parseExecutionTime(argv[++i]);
+    } else if (arg == "--slack" && i + 1 < argc) {
+      app.setSlackPolicy(parseSlackPolicy(argv[++i]));
+    } else if (arg == "--server" && i + 1 < argc) {
+      server = parseServer(argv[++i]);
+    } else if (arg == "--protocol" && i + 1 < argc) {
+      if (auto protocol = parseLockProtocol(argv[++i])) {
+        app.setLockProtocol(*protocol);
+      }
+    } else if (arg == "--section" && i + 1 < argc) {
+      if (auto section = parseCriticalSection(argv[++i])) {
+        sections[section->first].push_back(std::move(section->second));
+      }
+    } else if (arg == "--dvfs" && i + 1 < argc) {
+      dvfs = parseDvfsPolicy(argv[++i]);
+    } else if (arg == "--power" && i + 1 < argc) {
+      if (auto model = parsePowerModel(argv[++i])) {
+        power = *model;
+      }
+    } else if (arg == "--perf") {
+      perf = true;
+    } else if (arg == "--pin" && i + 1 < argc) {
+      app.pinWorkers(std::stoi(argv[++i]));
+    } else if (arg == "--dm") {
+      deadlineMonotonic = true;
+    } else if (arg == "--spread-offsets") {
+      spread = true;
+    }
+  }
+  if (customPreemption) {
+    app.setPreemptionModel(preemption);
+  }
+  if (dvfs) {
+    app.setDvfs(*dvfs, power);
+  }
+  if (logPath) {
+    app.logTo(*logPath, std::move(logFilter));
+  }
+  if (deadlineMonotonic) {
+    Transaction tx;
+    tx.algo = SchedulingAlgo::DM;
+    app.apply(std::move(tx));
+  }
+  if (spread) {
+    OffsetPlan plan = spreadOffsets(paramVector);
+    for (std::size_t i = 0; i < paramVector.size(); i++) {
+      paramVector[i].delay = plan.delays[i];
+    }
+    std::cout << "offsets: work released in the busiest " << plan.window
+              << "ms window " << plan.peakBefore << "ms -> " << plan.peakAfter << "ms"
+              << std::endl;
+  }
 
   app.initTasks(paramVector);
+  if (execTime) {
+    for (std::size_t id = 0; id < paramVector.size(); id++) {
+      app.setExecutionTime(static_cast<int>(id), *execTime);
+    }
+  }
+  for (auto &[id, list] : sections) {
+    app.setCriticalSections(id, std::move(list));
+  }
+  if (server) {
+    app.addServer(*server);
+  }
+  if (execute) {
+    for (std::size_t id = 0; id < paramVector.size(); id++) {
+      app.bindWorkload(
+          static_cast<int>(id), spinFor(std::chrono::milliseconds(paramVector[id].duration)));
+    }
+  } else if (coroutines) {
+    for (std::size_t id = 0; id < paramVector.size(); id++) {
+      std::chrono::milliseconds work(paramVector[id].duration);
+      app.bindCoroutine(static_cast<int>(id), [work](PreemptionPoint point) {
+        return spinCoroutine(point, work);
+      });
+    }
+  }
   SetTargetFPS(60);
   int frame{0};
   while (!WindowShouldClose()) {
@@ -33,5 +237,11 @@ int main() {
     EndDrawing();
     frame++;
   }
+  if (savePath) {
+    app.saveTasks(*savePath);
+  }
+  if (perf && !app.perfReport(std::cout)) {
+    std::cerr << "--perf needs a build with EDFSIM_PERF=ON" << std::endl;
+  }
   CloseWindow();
 }
\ No newline at end of file
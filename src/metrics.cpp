@@ -0,0 +1,114 @@
+#include "metrics.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define EDFSIM_HAS_SHM 1
+#endif
+
+int latencyBucket(std::chrono::steady_clock::duration latency) {
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(latency);
+  if (ms.count() <= 0) {
+    return 0;
+  }
+  int bucket = std::bit_width(static_cast<unsigned long>(ms.count()));
+  return std::min(bucket, latencyBuckets - 1);
+}
+
+MetricsSegment::MetricsSegment(std::string name) : name(std::move(name)) {
+#ifdef EDFSIM_HAS_SHM
+  int fd = shm_open(this->name.c_str(), O_CREAT | O_RDWR, 0644);
+  if (fd < 0) {
+    return;
+  }
+  if (ftruncate(fd, sizeof(MetricsLayout)) != 0) {
+    close(fd);
+    return;
+  }
+  void *mem = mmap(nullptr, sizeof(MetricsLayout), PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    return;
+  }
+  layout = static_cast<MetricsLayout *>(mem);
+  layout->seq.store(0, std::memory_order_relaxed);
+  layout->size = sizeof(MetricsLayout);
+  layout->version = metricsVersion;
+  std::memcpy(&layout->data, &local, sizeof(MetricsData));
+  std::atomic_thread_fence(std::memory_order_release);
+  layout->magic = metricsMagic;
+#endif
+}
+
+MetricsSegment::~MetricsSegment() {
+#ifdef EDFSIM_HAS_SHM
+  if (layout) {
+    munmap(layout, sizeof(MetricsLayout));
+    shm_unlink(name.c_str());
+  }
+#endif
+}
+
+void MetricsSegment::publish() {
+  if (!layout) {
+    return;
+  }
+  std::uint32_t seq = layout->seq.load(std::memory_order_relaxed);
+  layout->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(&layout->data, &local, sizeof(MetricsData));
+  layout->seq.store(seq + 2, std::memory_order_release);
+}
+
+MetricsReader::MetricsReader(const std::string &name) {
+#ifdef EDFSIM_HAS_SHM
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    return;
+  }
+  void *mem =
+      mmap(nullptr, sizeof(MetricsLayout), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    return;
+  }
+  layout = static_cast<const MetricsLayout *>(mem);
+#endif
+}
+
+MetricsReader::~MetricsReader() {
+#ifdef EDFSIM_HAS_SHM
+  if (layout) {
+    munmap(const_cast<MetricsLayout *>(layout), sizeof(MetricsLayout));
+  }
+#endif
+}
+
+std::optional<MetricsData> MetricsReader::read() const {
+  if (!layout || layout->magic != metricsMagic ||
+      layout->version != metricsVersion ||
+      layout->size != sizeof(MetricsLayout)) {
+    return std::nullopt;
+  }
+  MetricsData snapshot;
+  for (int attempt = 0; attempt < 1000; attempt++) {
+    std::uint32_t before = layout->seq.load(std::memory_order_acquire);
+    if (before & 1) {
+      continue;
+    }
+    std::memcpy(&snapshot, &layout->data, sizeof(MetricsData));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (layout->seq.load(std::memory_order_relaxed) == before) {
+      return snapshot;
+    }
+  }
+  return std::nullopt;
+}
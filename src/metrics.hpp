@@ -0,0 +1,80 @@
+// metrics.hpp - shared-memory metrics segment published by the scheduler
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+constexpr std::uint32_t metricsMagic = 0x45444653; // "EDFS"
+constexpr std::uint32_t metricsVersion = 5;
+constexpr int latencyBuckets = 16;
+constexpr const char *defaultMetricsName = "/edfsim";
+
+// Bucket 0 holds latencies under 1ms, bucket b holds [2^(b-1), 2^b) ms and
+// the last bucket collects everything above.
+int latencyBucket(std::chrono::steady_clock::duration latency);
+
+struct MetricsData {
+  std::int64_t updatedAt = 0; // ns since the scheduler started
+  std::uint64_t released = 0;
+  std::uint64_t started = 0;
+  std::uint64_t completed = 0;
+  std::uint64_t preempted = 0;
+  std::uint64_t missed = 0;
+  std::uint64_t overheadUs = 0;
+  std::int32_t runner = -1;
+  std::uint32_t taskCount = 0;
+  std::uint32_t queueDepth = 0;
+  std::uint32_t algo = 0;
+  std::uint64_t responseHist[latencyBuckets] = {};
+  std::uint64_t dispatchHist[latencyBuckets] = {};
+  std::uint64_t aperiodicCompleted = 0;
+  std::uint64_t aperiodicP50Us = 0;
+  std::uint64_t aperiodicP95Us = 0;
+  std::uint64_t aperiodicP99Us = 0;
+  std::uint64_t inversions = 0;
+  std::uint64_t blockedUs = 0;
+  std::uint64_t energyUs = 0; // at full-speed power
+  std::uint64_t speedPermille = 1000;
+};
+
+// Layout of the segment. Writers bump seq to an odd value before touching
+// data and back to even afterwards; readers retry on odd or changed seq.
+struct MetricsLayout {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::atomic<std::uint32_t> seq;
+  std::uint32_t size;
+  MetricsData data;
+};
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+
+class MetricsSegment {
+  std::string name;
+  MetricsLayout *layout = nullptr;
+  MetricsData local;
+
+public:
+  explicit MetricsSegment(std::string name);
+  MetricsSegment(const MetricsSegment &) = delete;
+  MetricsSegment &operator=(const MetricsSegment &) = delete;
+  ~MetricsSegment();
+  bool ok() const { return layout != nullptr; }
+  MetricsData &data() { return local; }
+  void publish();
+};
+
+class MetricsReader {
+  const MetricsLayout *layout = nullptr;
+
+public:
+  explicit MetricsReader(const std::string &name);
+  MetricsReader(const MetricsReader &) = delete;
+  MetricsReader &operator=(const MetricsReader &) = delete;
+  ~MetricsReader();
+  bool ok() const { return layout != nullptr; }
+  std::optional<MetricsData> read() const;
+};
@@ -0,0 +1,161 @@
+#include "perfcounters.hpp"
+
+#ifdef EDFSIM_PERF
+
+#include <bit>
+#include <cstdio>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+constexpr std::array<std::uint64_t, perfCounters> counterConfigs = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+const char *phaseName(PerfPhase phase) {
+  switch (phase) {
+  case PerfPhase::loop:
+    return "loop";
+  case PerfPhase::selectRunner:
+    return "selectRunner";
+  case PerfPhase::nextInterrupt:
+    return "nextInterrupt";
+  case PerfPhase::handleInterface:
+    return "handleInterface";
+  }
+  return "?";
+}
+
+// Bucket b holds task counts below 2^b.
+int taskBucket(std::size_t tasks) { return std::bit_width(tasks); }
+
+double perCall(std::uint64_t total, std::uint64_t calls) {
+  return calls ? static_cast<double>(total) / calls : 0;
+}
+} // namespace
+
+PerfGroup::PerfGroup() {
+  fds.fill(-1);
+  for (int i = 0; i < perfCounters; i++) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = counterConfigs[i];
+    attr.disabled = leader < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    int fd = static_cast<int>(
+        syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+    if (fd < 0) {
+      continue;
+    }
+    fds[i] = fd;
+    opened[i] = true;
+    if (leader < 0) {
+      leader = fd;
+    }
+  }
+  if (leader >= 0) {
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+PerfGroup::~PerfGroup() {
+  for (int fd : fds) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+PerfSample PerfGroup::read() const {
+  PerfSample sample;
+  sample.at = std::chrono::steady_clock::now();
+  if (leader < 0) {
+    return sample;
+  }
+  std::array<std::uint64_t, perfCounters + 1> buffer{};
+  if (::read(leader, buffer.data(), sizeof(buffer)) <= 0) {
+    return sample;
+  }
+  // The group is read back in the order the counters were opened.
+  int next = 1;
+  for (int i = 0; i < perfCounters; i++) {
+    if (opened[i] && next <= static_cast<int>(buffer[0])) {
+      sample.values[i] = buffer[next++];
+    }
+  }
+  sample.counted = true;
+  return sample;
+}
+
+PerfGroup &PerfGroup::local() {
+  thread_local PerfGroup group;
+  return group;
+}
+
+void PerfProfile::add(PerfPhase phase, std::size_t tasks,
+                      const PerfSample &begin, const PerfSample &end) {
+  std::lock_guard lk(totalsMTX);
+  Totals &t = totals[{phase, taskBucket(tasks)}];
+  t.calls++;
+  t.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       end.at - begin.at)
+                       .count();
+  if (!begin.counted || !end.counted) {
+    return;
+  }
+  t.counted++;
+  for (int i = 0; i < perfCounters; i++) {
+    t.values[i] += end.values[i] - begin.values[i];
+  }
+}
+
+void PerfProfile::report(std::ostream &out) {
+  char line[160];
+  std::snprintf(line, sizeof(line), "%-16s %7s %10s %10s %10s %6s %10s %10s\n",
+                "phase", "tasks<", "calls", "ns/call", "cycles", "IPC",
+                "cache-miss", "br-miss");
+  out << line;
+  std::lock_guard lk(totalsMTX);
+  bool uncounted = false;
+  for (const auto &[key, t] : totals) {
+    const auto &[phase, bucket] = key;
+    std::snprintf(line, sizeof(line), "%-16s %7llu %10llu %10.0f",
+                  phaseName(phase), 1ULL << bucket,
+                  static_cast<unsigned long long>(t.calls),
+                  perCall(t.nanoseconds, t.calls));
+    out << line;
+    if (t.counted == 0) {
+      uncounted = true;
+      out << "        n/a    n/a        n/a        n/a\n";
+      continue;
+    }
+    // Counter averages only cover the calls that had counters.
+    double cycles = perCall(t.values[0], t.counted);
+    double instructions = perCall(t.values[1], t.counted);
+    std::snprintf(line, sizeof(line), " %10.0f %6.2f %10.1f %10.1f\n", cycles,
+                  cycles > 0 ? instructions / cycles : 0,
+                  perCall(t.values[2], t.counted),
+                  perCall(t.values[3], t.counted));
+    out << line;
+  }
+  if (uncounted) {
+    out << "hardware counters unavailable, check "
+           "/proc/sys/kernel/perf_event_paranoid\n";
+  }
+}
+
+PerfScope::PerfScope(PerfProfile &profile, PerfPhase phase, std::size_t tasks)
+    : profile(profile), phase(phase), tasks(tasks),
+      begin(PerfGroup::local().read()) {}
+
+PerfScope::~PerfScope() {
+  profile.add(phase, tasks, begin, PerfGroup::local().read());
+}
+
+#endif
@@ -0,0 +1,85 @@
+// perfcounters.hpp - hardware counters around the scheduler's hot path
+#pragma once
+
+// Only built with -DEDFSIM_PERF=ON. Without it the scopes below expand to
+// nothing and the scheduler carries no profiling state at all.
+#ifdef EDFSIM_PERF
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <utility>
+
+enum class PerfPhase { loop = 0, selectRunner, nextInterrupt, handleInterface };
+
+// cycles, instructions, cache misses and branch misses
+constexpr int perfCounters = 4;
+
+struct PerfSample {
+  std::array<std::uint64_t, perfCounters> values{};
+  std::chrono::steady_clock::time_point at;
+  // False when the thread has no counters and only the time is valid.
+  bool counted = false;
+};
+
+// The counters of the calling thread, opened as one perf_event_open group
+// so a single read() returns all of them. Counters the kernel or hardware
+// refuses read as zero.
+class PerfGroup {
+  int leader = -1;
+  std::array<int, perfCounters> fds{};
+  std::array<bool, perfCounters> opened{};
+
+public:
+  PerfGroup();
+  PerfGroup(const PerfGroup &) = delete;
+  PerfGroup &operator=(const PerfGroup &) = delete;
+  ~PerfGroup();
+  PerfSample read() const;
+  // Schedulers can be polled from any thread, so each one gets its own.
+  static PerfGroup &local();
+};
+
+// Counter deltas summed per phase and per power-of-two bucket of the task
+// count. Safe to report from another thread while the scheduler runs.
+class PerfProfile {
+  struct Totals {
+    std::uint64_t calls = 0;
+    std::uint64_t counted = 0;
+    std::uint64_t nanoseconds = 0;
+    std::array<std::uint64_t, perfCounters> values{};
+  };
+  std::mutex totalsMTX;
+  std::map<std::pair<PerfPhase, int>, Totals> totals;
+
+public:
+  void add(PerfPhase phase, std::size_t tasks, const PerfSample &begin,
+           const PerfSample &end);
+  void report(std::ostream &out);
+};
+
+class PerfScope {
+  PerfProfile &profile;
+  PerfPhase phase;
+  std::size_t tasks;
+  PerfSample begin;
+
+public:
+  PerfScope(PerfProfile &profile, PerfPhase phase, std::size_t tasks);
+  PerfScope(const PerfScope &) = delete;
+  PerfScope &operator=(const PerfScope &) = delete;
+  ~PerfScope();
+};
+
+#define EDFSIM_PERF_SCOPE(phase, tasks)                                        \
+  PerfScope perfScope(perf, PerfPhase::phase, tasks)
+
+#else
+
+#define EDFSIM_PERF_SCOPE(phase, tasks)
+
+#endif
@@ -1,20 +1,58 @@
 #pragma once
 
+#include <chrono>
+#include <tuple>
+
 enum class EventType {
   start = 0,
   complete,
   preempt,
   missed,
   initialize,
-  restart
+  restart,
+  // A ready job outranks the runner and waits for it: priority inversion,
+  // from a lock, a ceiling or a non-preemptible runner.
+  block,
+  unblock
 };
 
-enum class SchedulingAlgo { EDF = 0, RMS };
+// Earliest deadline first, and fixed priorities by period (rate monotonic)
+// or by relative deadline (deadline monotonic).
+enum class SchedulingAlgo { EDF = 0, RMS, DM };
+
+inline const char *algoName(SchedulingAlgo algo) {
+  switch (algo) {
+  case SchedulingAlgo::EDF:
+    return "EDF";
+  case SchedulingAlgo::RMS:
+    return "RMS";
+  case SchedulingAlgo::DM:
+    return "DM";
+  }
+  return "?";
+}
+
+// When an edited period or duration takes effect: from the task's next
+// release on, or already for the job in progress.
+enum class EditMode { nextRelease = 0, immediate };
+
+// A periodic task, all in ms. Job k arrives at delay + k * period and is
+// released up to jitter later; it is due deadline after its arrival, where
+// 0 means at the end of its period. Deadlines are constrained: one longer
+// than the period counts as the period.
+struct TaskParams {
+  long period = 0;
+  long duration = 0;
+  long delay = 0;
+  long deadline = 0;
+  long jitter = 0;
+};
 
 class Event {
 public:
   EventType type;
   int id;
   long timeSince = 0;
+  std::chrono::steady_clock::time_point time{};
   Event(EventType type, int procID) : type(type), id(procID) {}
 };
@@ -0,0 +1,69 @@
+#include "resource.hpp"
+#include <algorithm>
+#include <charconv>
+#include <system_error>
+
+std::optional<LockProtocol> parseLockProtocol(std::string_view name) {
+  if (name == "none") {
+    return LockProtocol::none;
+  }
+  if (name == "pip") {
+    return LockProtocol::inheritance;
+  }
+  if (name == "pcp") {
+    return LockProtocol::ceiling;
+  }
+  if (name == "srp") {
+    return LockProtocol::stackResource;
+  }
+  return std::nullopt;
+}
+
+std::optional<std::pair<int, CriticalSection>>
+parseCriticalSection(std::string_view spec) {
+  auto first = spec.find(':');
+  auto second = spec.find(':', first + 1);
+  auto third = spec.find(':', second + 1);
+  if (first == std::string_view::npos || second == std::string_view::npos ||
+      third == std::string_view::npos || second == first + 1) {
+    return std::nullopt;
+  }
+  int task = 0;
+  long start = 0;
+  long length = 0;
+  const char *end = spec.data() + spec.size();
+  auto [taskEnd, taskEc] =
+      std::from_chars(spec.data(), spec.data() + first, task);
+  auto [startEnd, startEc] =
+      std::from_chars(spec.data() + second + 1, spec.data() + third, start);
+  auto [lengthEnd, lengthEc] =
+      std::from_chars(spec.data() + third + 1, end, length);
+  if (taskEc != std::errc{} || startEc != std::errc{} ||
+      lengthEc != std::errc{} || taskEnd != spec.data() + first ||
+      startEnd != spec.data() + third || lengthEnd != end || task < 0 ||
+      start < 0 || length <= 0) {
+    return std::nullopt;
+  }
+  return std::pair{
+      task, CriticalSection{std::string(spec.substr(first + 1,
+                                                    second - first - 1)),
+                            std::chrono::milliseconds(start),
+                            std::chrono::milliseconds(length)}};
+}
+
+std::vector<CriticalSection>
+normalizeSections(std::vector<CriticalSection> sections) {
+  std::erase_if(sections, [](const CriticalSection &s) {
+    return s.resource.empty() || s.start < s.start.zero() ||
+           s.length <= s.length.zero();
+  });
+  std::ranges::stable_sort(sections, {}, &CriticalSection::start);
+  std::vector<CriticalSection> result;
+  for (CriticalSection &s : sections) {
+    if (result.empty() ||
+        result.back().start + result.back().length <= s.start) {
+      result.push_back(std::move(s));
+    }
+  }
+  return result;
+}
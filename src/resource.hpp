@@ -0,0 +1,41 @@
+// resource.hpp - critical sections on shared resources and locking protocols
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// How a job that needs a resource held by a lower priority one is treated.
+// none lets it wait while anything else runs, so a medium priority job can
+// stretch the inversion without bound. inheritance lends the holder the
+// priority of the jobs it blocks. ceiling (Priority Ceiling Protocol) also
+// refuses a lock unless the job outranks the ceiling of every resource held
+// by others. stackResource (SRP) never blocks on a lock: a job may not
+// start until its preemption level is above the system ceiling. Ceilings
+// and preemption levels come from periods for both EDF and RMS, so a
+// shorter period is a higher level.
+enum class LockProtocol { none = 0, inheritance, ceiling, stackResource };
+
+// The resource is held while the job's executed work is in
+// [start, start + length).
+struct CriticalSection {
+  std::string resource;
+  std::chrono::milliseconds start;
+  std::chrono::milliseconds length;
+  bool operator==(const CriticalSection &) const = default;
+};
+
+// Parses none, pip, pcp or srp.
+std::optional<LockProtocol> parseLockProtocol(std::string_view name);
+
+// Parses <task>:<resource>:<start>:<length>, times in ms.
+std::optional<std::pair<int, CriticalSection>>
+parseCriticalSection(std::string_view spec);
+
+// Sorts sections by start and drops empty ones and any that overlap an
+// earlier one: sections do not nest, so a job holds one resource at a time.
+std::vector<CriticalSection>
+normalizeSections(std::vector<CriticalSection> sections);
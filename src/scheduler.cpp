@@ -1,263 +1,2143 @@
 #include "scheduler.hpp"
+#include "analysis.hpp"
+#include "host.hpp"
 #include "process.hpp"
 #include <algorithm>
 #include <chrono>
 #include <iterator>
+#include <limits>
 #include <mutex>
+#include <numeric>
 #include <ranges>
 
-Task::Task(long period, long duration,
-           std::chrono::steady_clock::time_point nextInterrupt, int id)
-    : duration(std::chrono::milliseconds(duration)),
-      period(std::chrono::milliseconds(period)), nextInterrupt(nextInterrupt),
-      id(id) {}
+namespace {
+constexpr std::chrono::hours maxHyperperiod{1};
+constexpr std::size_t maxTableEntries = 1 << 20;
+constexpr int maxCompileAttempts = 4;
+} // namespace
+
+Task::Task(const TaskParams &params,
+           std::chrono::steady_clock::time_point arrival, int id)
+    : id(id), period(std::chrono::milliseconds(params.period)),
+      duration(std::chrono::milliseconds(params.duration)),
+      deadlineParam(std::chrono::milliseconds(params.deadline)),
+      jitter(std::chrono::milliseconds(params.jitter)),
+      demand(std::chrono::milliseconds(params.duration)),
+      nextInterrupt(arrival), arrival(arrival), release(arrival) {}
 
 void Task::run(std::chrono::steady_clock::duration duration) {
-  runTime += std::chrono::duration_cast<std::chrono::milliseconds>(duration);
+  runTime += duration;
 }
 
 Scheduler::Scheduler(SchedulingAlgo algo, std::function<void(Event)> interface)
-    : startTime(timer.now()), algo(algo), eventInterface(interface) {}
+    : startTime(timer.now()), energyAt(startTime), algo(algo),
+      eventInterface(interface) {}
 
-Scheduler::~Scheduler() { this->stop(); }
+Scheduler::~Scheduler() {
+  this->stop();
+  // The compiler posts its result back here, so it has to go first.
+  compiler.request_stop();
+  if (compiler.joinable()) {
+    compiler.join();
+  }
+  // Workers finishing a job call wake(), which needs slice and host; both
+  // are declared after executor and would be gone by its own teardown.
+  executor.reset();
+}
 
 void Scheduler::stop() {
   running = false;
+  slice.signalled = true;
+  if (SchedulerHost *h = host.load()) {
+    h->wake(hostSlot);
+  }
   CV.notify_all();
 }
 
-void Scheduler::addTask(std::tuple<long, long, long, int> &taskParam) {
-  const auto &[period, duration, delay, id] = taskParam;
-  tasks.insert(
-      {id,
-       {period, duration, timer.now() + std::chrono::milliseconds(delay), id}});
+void Scheduler::wake() {
+  slice.signalled.store(true, std::memory_order_relaxed);
+  if (SchedulerHost *h = host.load()) {
+    h->wake(hostSlot);
+  } else {
+    CV.notify_one();
+  }
 }
 
-void Scheduler::deleteTask(int id) { tasks.erase(id); }
+std::chrono::steady_clock::time_point Scheduler::now() {
+  return virtualNow ? *virtualNow : timer.now();
+}
 
-void Scheduler::handleInterface() {
-  {
-    std::lock_guard lk(interfaceMTX);
+void Scheduler::addTask(
+    const std::tuple<TaskParams, std::chrono::steady_clock::time_point, int>
+        &taskParam) {
+  const auto &[params, arrival, id] = taskParam;
+  auto [it, added] = tasks.insert({id, {params, arrival, id}});
+  if (added) {
+    scheduleRelease(it->second, arrival);
+    it->second.nextInterrupt = it->second.release;
+  }
+}
 
-    if (!incoming.empty()) {
-      for (auto param : incoming) {
-        addTask(param);
-      }
-      incoming.clear();
-    }
+void Scheduler::deleteTask(int id) {
+  if (auto it = tasks.find(id); it != tasks.end() && it->second.holding) {
+    unlock(it->second);
+  }
+  tasks.erase(id);
+  coroutines.erase(id);
+  if (executor) {
+    executor->unbind(id);
+  }
+}
 
-    if (!tasksToRemove.empty()) {
-      for (int id : tasksToRemove) {
-        deleteTask(id);
-      }
-      tasksToRemove.clear();
-    }
+// Edits keep the task's id, history and accounting and only re-arm its own
+// timer. nextRelease leaves the job in progress alone; immediate re-derives
+// its deadline from its release and its completion from the work done so
+// far, so it may complete or miss at once if the new values are exceeded.
+void Scheduler::applyEdit(const TaskEdit &edit) {
+  auto it = tasks.find(edit.id);
+  if (it == tasks.end() || edit.period <= 0 || edit.duration <= 0) {
+    return;
+  }
+  Task &t = it->second;
+  std::chrono::milliseconds period(edit.period);
+  std::chrono::milliseconds duration(edit.duration);
+  if (t.server) {
+    t.period = period;
+    t.duration = duration;
+    t.server->budget = std::min(t.server->budget, duration);
+    settleServer(t);
+    return;
+  }
+  if (edit.mode == EditMode::nextRelease &&
+      t.status != TaskStatus::uninitialized) {
+    t.nextParams = {period, duration};
+    return;
+  }
+  t.nextParams.reset();
+  t.period = period;
+  t.duration = duration;
+  if (t.execTime.fixed()) {
+    t.demand = duration;
+  }
+  if (t.status == TaskStatus::uninitialized) {
+    return;
+  }
+  t.deadline = t.refPoint + t.relativeDeadline();
+  auto lag = t.release - t.arrival;
+  t.arrival = t.refPoint + t.period;
+  t.release = t.arrival + lag;
+  if (t.status == TaskStatus::running) {
+    armRunner(t);
+  } else {
+    armDeadline(t);
+  }
+}
 
-    if (runTaskIndex && !tasks.contains(runTaskIndex.value())) {
-      runTaskIndex.reset();
-    }
-    if (algoBuf) {
-      algo = *algoBuf;
-      algoBuf.reset();
-    }
+bool Scheduler::onWorker(int id) { return executor && executor->bound(id); }
+
+bool Scheduler::executes(int id) {
+  return onWorker(id) || coroutines.contains(id);
+}
+
+// Starts job number t.job of a task with a workload or coroutine body,
+// superseding any unfinished previous job.
+void Scheduler::releaseJob(Task &t) {
+  if (onWorker(t.id)) {
+    executor->release(t.id, t.job);
+  }
+  if (coroutines.contains(t.id)) {
+    CoroutineTask &c = coroutines.at(t.id);
+    c.job = c.body(PreemptionPoint(&slice));
+    c.jobId = t.job;
+    c.executed = c.executed.zero();
   }
 }
 
-void Scheduler::initTasks(
-    std::vector<std::tuple<long, long, long>> paramVector) {
-  {
-    std::lock_guard lk(interfaceMTX);
-    for (int i = 0; i < paramVector.size(); i++) {
-      const auto &[period, duration, delay] = paramVector[i];
-      incoming.emplace_back(period, duration, delay, nextId);
-      nextId++;
-    }
+// Sets when the next job of t arrives and draws how late it is released.
+// Tasks without jitter leave the random stream alone, so their runs replay
+// exactly as before jitter existed.
+void Scheduler::scheduleRelease(Task &t,
+                                std::chrono::steady_clock::time_point arrival) {
+  t.arrival = arrival;
+  t.release = arrival;
+  if (t.jitter > t.jitter.zero()) {
+    t.release += std::chrono::milliseconds(
+        std::uniform_int_distribution<long>(0, t.jitter.count())(rng));
   }
-  CV.notify_one();
 }
 
-std::tuple<std::chrono::steady_clock::time_point, int, Interrupt>
-Scheduler::nextInterrupt() {
-  if (tasks.empty()) {
-    return {timer.now() + std::chrono::days(2), -1, Interrupt::taskInit};
+// Arms t's timer for the end of its job: the deadline while the job is
+// pending, the next release once it is over. Under implicit deadlines
+// without jitter the two coincide and the release also detects the miss.
+void Scheduler::armDeadline(Task &t) {
+  bool pending =
+      t.status == TaskStatus::waiting || t.status == TaskStatus::running;
+  if (pending && t.deadline < t.release) {
+    t.nextInterrupt = t.deadline;
+    t.onWake = Interrupt::deadlineMissed;
+  } else {
+    t.nextInterrupt = t.release;
+    t.onWake = Interrupt::taskRestart;
   }
+}
 
-  const auto it = std::ranges::min_element(
-      tasks, {}, [](const auto t) { return t.second.nextInterrupt; });
-  const auto &[id, task] = *it;
-  return {task.nextInterrupt, id, task.onWake};
+// Samples how much work the job just released really needs.
+void Scheduler::drawDemand(Task &t) {
+  t.demand = t.execTime.sample(rng, t.duration);
+  t.granted = t.granted.zero();
+  t.background = false;
 }
 
-void Scheduler::handleInterrupt(std::tuple<int, Interrupt> firedInterrupt) {
-  const auto &[id, interrupt] = firedInterrupt;
+std::chrono::milliseconds Scheduler::work(const Task &t) const {
+  return slackPolicy == SlackPolicy::none ? t.duration : t.demand;
+}
 
-  switch (interrupt) {
-  case Interrupt::taskInit: {
-    if (!tasks.contains(id)) {
-      return;
-    }
-    Task &t = tasks.at(id);
-    t.status = TaskStatus::waiting;
-    t.refPoint = timer.now();
-    t.deadline = timer.now() + t.period;
-    if (eventInterface) {
-      eventInterface({EventType::initialize, t.id});
+// Keeps what a completed job left of its budget until the job's deadline.
+void Scheduler::donateSlack(const Task &t) {
+  auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+      t.duration + t.granted + t.overhead - t.runTime);
+  if (left <= left.zero()) {
+    return;
+  }
+  auto at = std::ranges::upper_bound(spare, t.deadline, {},
+                                     &SpareCapacity::deadline);
+  spare.insert(at, {t.deadline, left});
+}
+
+// A job past its budget only runs in background on time nobody else
+// claims, which is spare capacity first; charging it keeps that capacity
+// from being handed out a second time.
+void Scheduler::chargeSpare(const Task &t) {
+  if (!t.background) {
+    return;
+  }
+  auto used = std::chrono::duration_cast<std::chrono::milliseconds>(
+      scaled(now() - latestCP));
+  auto it = spare.begin();
+  while (it != spare.end() && used > used.zero()) {
+    auto take = std::min(it->amount, used);
+    used -= take;
+    it->amount -= take;
+    it = it->amount > it->amount.zero() ? std::next(it) : spare.erase(it);
+  }
+}
+
+// Covers as much of an overrunning job's remaining work as possible with
+// unexpired spare capacity, earliest deadline first. Without any, the job
+// only runs when nothing else is ready.
+void Scheduler::claimSlack(Task &t) {
+  std::erase_if(spare, [this](const SpareCapacity &c) {
+    return c.deadline <= now();
+  });
+  auto needed = std::chrono::ceil<std::chrono::milliseconds>(
+      t.demand + t.overhead - t.runTime);
+  auto before = t.granted;
+  auto it = spare.begin();
+  while (it != spare.end() && it->deadline <= t.deadline &&
+         needed > needed.zero()) {
+    auto take = std::min(it->amount, needed);
+    t.granted += take;
+    needed -= take;
+    it->amount -= take;
+    it = it->amount > it->amount.zero() ? std::next(it) : spare.erase(it);
+  }
+  if (t.granted == before) {
+    t.background = true;
+  }
+}
+
+// Charges the time the running server used since the last checkpoint to
+// its head job, as work at the current speed, and to its budget.
+void Scheduler::chargeServer(Task &t) {
+  auto used = now() - latestCP;
+  t.runTime += scaled(used);
+  t.server->budget -=
+      std::chrono::duration_cast<std::chrono::milliseconds>(used);
+  latestCP = now();
+}
+
+// A job arriving at an idle constant bandwidth server may only keep the
+// current deadline if the budget left fits the server's bandwidth until
+// then; otherwise the server starts over with a fresh budget and deadline.
+void Scheduler::enqueueJob(Task &t, AperiodicJob job) {
+  ServerState &s = *t.server;
+  bool idle = s.queue.empty();
+  s.queue.push_back(job);
+  if (!idle || t.status == TaskStatus::uninitialized) {
+    return;
+  }
+  if (s.kind == ServerKind::constantBandwidth) {
+    auto arrival = now();
+    double left = std::chrono::duration<double, std::milli>(t.deadline -
+                                                            arrival)
+                      .count();
+    if (left <= 0 || s.budget.count() * static_cast<double>(t.period.count()) >=
+                         left * t.duration.count()) {
+      t.deadline = arrival + t.period;
+      s.budget = t.duration;
     }
-    t.nextInterrupt = t.deadline;
-    t.onWake = Interrupt::taskRestart;
-  } break;
-  case Interrupt::taskRestart: {
-    if (!tasks.contains(id)) {
-      return;
+  }
+  settleServer(t);
+}
+
+// Applies the server's budget rules and derives whether it may run: it
+// needs a queued job and budget left.
+void Scheduler::settleServer(Task &t) {
+  ServerState &s = *t.server;
+  if (s.kind == ServerKind::polling && s.queue.empty()) {
+    s.budget = s.budget.zero();
+  }
+  if (s.kind == ServerKind::constantBandwidth &&
+      s.budget <= s.budget.zero()) {
+    s.budget = t.duration;
+    t.deadline += t.period;
+  }
+  if (t.status == TaskStatus::uninitialized) {
+    return;
+  }
+  bool eligible = !s.queue.empty() && s.budget > s.budget.zero();
+  if (eligible) {
+    if (t.status != TaskStatus::running) {
+      t.status = TaskStatus::waiting;
     }
-    Task &t = tasks.at(id);
-    t.refPoint = timer.now();
-    if (t.status != TaskStatus::completed) {
-      if (t.status == TaskStatus::running) {
-        runTaskIndex.reset();
-      }
-      if (eventInterface) {
-        eventInterface({EventType::missed, t.id});
-      }
-    } else {
-      if (eventInterface) {
-        eventInterface({EventType::restart, t.id});
+  } else {
+    if (t.status == TaskStatus::running) {
+      runTaskIndex.reset();
+      if (!s.queue.empty()) {
+        t.preempted = true;
+        emit({EventType::preempt, t.id});
       }
     }
-    t.status = TaskStatus::waiting;
-    t.runTime = t.runTime.zero();
-    t.deadline = timer.now() + t.period;
-    t.nextInterrupt = t.deadline;
-    t.onWake = Interrupt::taskRestart;
-    break;
+    t.status = TaskStatus::completed;
+  }
+  armServer(t);
+}
+
+// A running server wakes when its head job completes or its budget runs
+// out; polling and deferrable servers also wake at each replenishment.
+void Scheduler::armServer(Task &t) {
+  ServerState &s = *t.server;
+  auto wakeup = std::chrono::steady_clock::time_point::max();
+  auto onWake = Interrupt::taskRestart;
+  if (s.kind != ServerKind::constantBandwidth) {
+    wakeup = t.deadline;
+  }
+  if (t.status == TaskStatus::running) {
+    auto completion =
+        latestCP + wallTime(s.queue.front().work + t.overhead - t.runTime);
+    auto exhausted = latestCP + s.budget;
+    auto at = std::min(completion, exhausted);
+    if (at <= wakeup) {
+      wakeup = at;
+      onWake = completion <= exhausted ? Interrupt::taskComplete
+                                       : Interrupt::budgetExhausted;
+    }
   }
+  t.nextInterrupt = wakeup;
+  t.onWake = onWake;
+}
+
+void Scheduler::serverInterrupt(Task &t, Interrupt interrupt) {
+  ServerState &s = *t.server;
+  switch (interrupt) {
+  case Interrupt::taskInit:
+  case Interrupt::taskRestart:
+    if (t.status == TaskStatus::running) {
+      chargeServer(t);
+    } else if (t.status == TaskStatus::uninitialized) {
+      t.status = TaskStatus::completed;
+    }
+    t.refPoint = t.nextInterrupt;
+    t.deadline = t.refPoint + t.period;
+    s.budget = t.duration;
+    break;
   case Interrupt::taskComplete: {
-    if (!tasks.contains(id)) {
-      return;
+    chargeServer(t);
+    auto response = now() - s.queue.front().arrival;
+    s.queue.pop_front();
+    s.responses.add(response);
+    aperiodic.add(response);
+    if (metrics) {
+      MetricsData &m = metrics->data();
+      m.aperiodicCompleted = aperiodic.count();
+      m.aperiodicP50Us = aperiodic.percentile(0.5).count();
+      m.aperiodicP95Us = aperiodic.percentile(0.95).count();
+      m.aperiodicP99Us = aperiodic.percentile(0.99).count();
     }
-    Task &t = tasks.at(id);
-    t.run((timer.now() - latestCP));
-    t.status = TaskStatus::completed;
+    t.runTime = t.runTime.zero();
+    t.overhead = t.overhead.zero();
+    t.preempted = false;
+    t.status = TaskStatus::waiting;
     runTaskIndex.reset();
-    if (eventInterface) {
-      eventInterface({EventType::complete, t.id});
-    }
-    t.nextInterrupt = t.deadline;
-    t.onWake = Interrupt::taskRestart;
+    emit({EventType::complete, t.id});
+  } break;
+  case Interrupt::budgetExhausted:
+    chargeServer(t);
     break;
-  }
+  case Interrupt::preemptionPoint:
+    t.atPoint = true;
+    break;
+  case Interrupt::deadlineMissed:
   case Interrupt::taskEdited:
-    handleInterface();
+  case Interrupt::sectionBoundary:
     break;
   }
+  settleServer(t);
 }
 
-void Scheduler::selectRunner() {
-  if (tasks.empty()) {
-    return;
+// Base priority, before anything a protocol lends: the earlier deadline
+// under EDF, the shorter period under RMS, the shorter relative deadline
+// under DM.
+bool Scheduler::outranks(const Task &a, const Task &b) const {
+  switch (algo) {
+  case SchedulingAlgo::EDF:
+    return a.deadline < b.deadline;
+  case SchedulingAlgo::RMS:
+    return a.period < b.period;
+  case SchedulingAlgo::DM:
+    return a.relativeDeadline() < b.relativeDeadline();
   }
-  auto filtered = tasks | std::views::filter([](const auto &t) {
-                    return t.second.status == TaskStatus::waiting ||
-                           t.second.status == TaskStatus::running;
-                  });
+  return false;
+}
 
-  if (std::ranges::empty(filtered)) {
-    runTaskIndex.reset();
+// Highest preemption level among the tasks using resource. A task's level
+// is its negated relative deadline, which is its period unless given.
+long Scheduler::ceiling(const std::string &resource) const {
+  long level = std::numeric_limits<long>::min();
+  for (const auto &[id, t] : tasks) {
+    if (std::ranges::any_of(t.sections, [&](const CriticalSection &s) {
+          return s.resource == resource;
+        })) {
+      level = std::max<long>(level, -t.relativeDeadline().count());
+    }
+  }
+  return level;
+}
+
+// The task that keeps t from entering its next section: the holder of its
+// resource, or under the ceiling protocol the holder of the highest ceiling
+// t does not outrank.
+std::optional<int> Scheduler::lockBlocker(const Task &t) const {
+  const std::string &wanted = t.sections[t.section].resource;
+  std::optional<int> blocker;
+  long highest = std::numeric_limits<long>::min();
+  for (const auto &[id, other] : tasks) {
+    if (id == t.id || !other.holding) {
+      continue;
+    }
+    const std::string &held = other.sections[other.section].resource;
+    if (held == wanted) {
+      return id;
+    }
+    if (protocol == LockProtocol::ceiling) {
+      long level = ceiling(held);
+      if (level >= -t.relativeDeadline().count() &&
+          (!blocker || level > highest)) {
+        blocker = id;
+        highest = level;
+      }
+    }
+  }
+  return blocker;
+}
+
+// Enters the runner's next critical section, or takes the runner off the
+// processor until the task blocking it unlocks.
+void Scheduler::lock(Task &t) {
+  t.blockedOn = lockBlocker(t);
+  if (!t.blockedOn) {
+    t.holding = true;
     return;
   }
+  t.status = TaskStatus::waiting;
+  t.preempted = true;
+  armDeadline(t);
+  runTaskIndex.reset();
+  emit({EventType::preempt, t.id});
+}
 
-  auto it = std::ranges::min_element(filtered, {}, [this](const auto &t) {
-    return ((algo == SchedulingAlgo::EDF)
-                ? ((t.second.deadline > timer.now())
-                       ? t.second.deadline - timer.now()
-                       : std::chrono::milliseconds::max())
-                : t.second.period);
+// Releases t's resource. The jobs it blocked retry their locks in priority
+// order, so the best of them is handed the resource and the rest now wait
+// for that one. Jobs already dropped are not handed anything.
+void Scheduler::unlock(Task &t) {
+  t.holding = false;
+  std::vector<Task *> waiters;
+  for (auto &[id, other] : tasks) {
+    if (other.blockedOn == t.id && (other.status == TaskStatus::waiting ||
+                                    other.status == TaskStatus::running)) {
+      other.blockedOn.reset();
+      waiters.push_back(&other);
+    }
+  }
+  std::ranges::stable_sort(waiters, [this](const Task *a, const Task *b) {
+    return outranks(*a, *b);
   });
+  for (Task *w : waiters) {
+    w->blockedOn = lockBlocker(*w);
+    w->holding = !w->blockedOn;
+  }
+}
 
-  const auto &[id, task] = *it;
+// Opens a blocked interval for every ready job that outranks the runner,
+// whatever keeps it waiting, and closes it once that stops. Background jobs
+// have given up their priority and are left out.
+void Scheduler::trackInversions() {
+  auto found = runTaskIndex ? tasks.find(runTaskIndex.value()) : tasks.end();
+  for (auto &[id, t] : tasks) {
+    bool inverted = found != tasks.end() && t.status == TaskStatus::waiting &&
+                    !t.background && outranks(t, found->second);
+    if (inverted == t.blockedSince.has_value()) {
+      continue;
+    }
+    if (inverted) {
+      t.blockedSince = now();
+      t.inversions++;
+      emit({EventType::block, id});
+      continue;
+    }
+    auto blocked = now() - *t.blockedSince;
+    t.blockedFor += blocked;
+    t.blockedSince.reset();
+    if (metrics) {
+      metrics->data().blockedUs +=
+          std::chrono::duration_cast<std::chrono::microseconds>(blocked)
+              .count();
+    }
+    emit({EventType::unblock, id});
+  }
+}
 
-  if (id != runTaskIndex) {
-    if (runTaskIndex) {
-      Task &oldRunner = tasks.at(runTaskIndex.value());
-      oldRunner.run((timer.now() - latestCP));
-      oldRunner.status = TaskStatus::waiting;
-      oldRunner.nextInterrupt = oldRunner.deadline;
-      oldRunner.onWake = Interrupt::taskRestart;
-      if (eventInterface) {
-        eventInterface({EventType::preempt, oldRunner.id});
-      }
+std::chrono::steady_clock::duration
+Scheduler::scaled(std::chrono::steady_clock::duration span) const {
+  if (speed == 1) {
+    return span;
+  }
+  return std::chrono::round<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double, std::chrono::steady_clock::period>(span) *
+      speed);
+}
+
+std::chrono::steady_clock::duration
+Scheduler::wallTime(std::chrono::steady_clock::duration work) const {
+  if (speed == 1) {
+    return work;
+  }
+  return std::chrono::ceil<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double, std::chrono::steady_clock::period>(work) /
+      speed);
+}
+
+// Worst-case work the job in progress still needs, counting what the
+// runner did since the last checkpoint. A server needs its budget while it
+// has jobs queued.
+std::chrono::steady_clock::duration Scheduler::remaining(const Task &t) {
+  if (t.status != TaskStatus::waiting && t.status != TaskStatus::running) {
+    return {};
+  }
+  if (t.server) {
+    return t.server->queue.empty() ? std::chrono::milliseconds::zero()
+                                   : t.server->budget;
+  }
+  auto done = t.runTime;
+  if (runTaskIndex == t.id) {
+    done += scaled(now() - latestCP);
+  }
+  return std::max<std::chrono::steady_clock::duration>(
+      t.duration + t.overhead - done, {});
+}
+
+// Lowest level at which the worst case passes the test of the policy,
+// cached until the task set changes.
+double Scheduler::staticLevel() {
+  if (staticSpeed) {
+    return *staticSpeed;
+  }
+  std::vector<AnalysisTask> taskSet;
+  for (const auto &[id, t] : tasks) {
+    taskSet.push_back({static_cast<double>(t.period.count()),
+                       static_cast<double>(t.duration.count()),
+                       static_cast<double>(t.relativeDeadline().count()),
+                       static_cast<double>(t.jitter.count())});
+  }
+  staticSpeed = 1.0;
+  for (double level : power.levels) {
+    std::vector<AnalysisTask> slowed = taskSet;
+    for (AnalysisTask &task : slowed) {
+      task.duration /= level;
     }
-    runTaskIndex = id;
-    Task &t = tasks.at(id);
-    t.status = TaskStatus::running;
-    auto remainingDuration = t.duration - t.runTime;
+    if (feasible(slowed, algo)) {
+      staticSpeed = level;
+      break;
+    }
+  }
+  return *staticSpeed;
+}
+
+// Cycle-conserving EDF: the utilization of the task set with each job
+// that already finished counted at its actual work.
+double Scheduler::conservingSpeed() {
+  double utilization = 0;
+  for (const auto &[id, t] : tasks) {
+    double work = t.status == TaskStatus::completed && !t.server
+                      ? std::chrono::duration<double, std::milli>(t.runTime)
+                            .count()
+                      : t.duration.count();
+    utilization += work / t.period.count();
+  }
+  return utilization;
+}
+
+// Look-ahead EDF: walking the jobs from the latest deadline back, pushes
+// as much of each one's remaining work past the earliest deadline as the
+// utilization left for it allows, and returns the speed needed to finish
+// the rest by then.
+double Scheduler::lookAheadSpeed() {
+  struct Pending {
+    std::chrono::steady_clock::time_point deadline;
+    double utilization;
+    double left;
+  };
+  std::vector<Pending> jobs;
+  double utilization = 0;
+  for (const auto &[id, t] : tasks) {
+    auto deadline = t.status == TaskStatus::uninitialized
+                        ? t.arrival + t.relativeDeadline()
+                        : t.deadline;
+    double share = static_cast<double>(t.duration.count()) / t.period.count();
+    utilization += share;
+    jobs.push_back(
+        {deadline, share,
+         std::chrono::duration<double, std::milli>(remaining(t)).count()});
+  }
+  if (jobs.empty()) {
+    return 0;
+  }
+  std::ranges::sort(jobs, std::ranges::greater{}, &Pending::deadline);
+  auto earliest = jobs.back().deadline;
+  double window =
+      std::chrono::duration<double, std::milli>(earliest - now()).count();
+  if (window <= 0) {
+    return 1;
+  }
+  double urgent = 0;
+  for (const Pending &job : jobs) {
+    utilization -= job.utilization;
+    double gap =
+        std::chrono::duration<double, std::milli>(job.deadline - earliest)
+            .count();
+    double early = std::max(0.0, job.left - (1 - utilization) * gap);
+    if (gap > 0) {
+      utilization += (job.left - early) / gap;
+    }
+    urgent += early;
+  }
+  return urgent / window;
+}
 
-    if (eventInterface) {
-      eventInterface({EventType::start, t.id});
+// Cycle-conserving RMS: until the next deadline, do as much work as the
+// static slowdown schedule would, handing its cycles to the remaining work
+// in priority order; jobs that finished early leave theirs unclaimed.
+double Scheduler::pacedSpeed() {
+  double base = staticLevel();
+  auto next = std::chrono::steady_clock::time_point::max();
+  std::vector<Task *> order;
+  for (auto &[id, t] : tasks) {
+    next = std::min(next, t.status == TaskStatus::uninitialized
+                              ? t.nextInterrupt
+                              : t.deadline);
+    order.push_back(&t);
+  }
+  double window =
+      std::chrono::duration<double, std::milli>(next - now()).count();
+  if (order.empty() || window <= 0) {
+    return base;
+  }
+  std::ranges::stable_sort(order, {}, [this](const Task *t) {
+    return algo == SchedulingAlgo::DM ? t->relativeDeadline() : t->period;
+  });
+  double cycles = base * window;
+  double allotted = 0;
+  for (Task *t : order) {
+    double take = std::min(
+        std::chrono::duration<double, std::milli>(remaining(*t)).count(),
+        cycles - allotted);
+    allotted += take;
+    if (allotted >= cycles) {
+      break;
     }
+  }
+  return allotted / window;
+}
 
-    if (t.deadline < remainingDuration + timer.now()) {
-      t.nextInterrupt = t.deadline;
-      t.onWake = Interrupt::taskRestart;
+// Moves the processor to the speed the DVFS policy asks for. The runner's
+// work so far is charged at the old speed and its interrupts re-armed for
+// the new one; a runner waiting for a preemption point keeps its speed
+// until the next decision.
+void Scheduler::adjustSpeed() {
+  double target = 1;
+  switch (dvfs) {
+  case DvfsPolicy::off:
+    break;
+  case DvfsPolicy::staticSlowdown:
+    target = power.levelFor(staticLevel());
+    break;
+  case DvfsPolicy::cycleConserving:
+    target = power.levelFor(algo == SchedulingAlgo::EDF ? conservingSpeed()
+                                                        : pacedSpeed());
+    break;
+  case DvfsPolicy::lookAhead:
+    target = power.levelFor(algo == SchedulingAlgo::EDF ? lookAheadSpeed()
+                                                        : pacedSpeed());
+    break;
+  }
+  if (target == speed) {
+    return;
+  }
+  if (runTaskIndex) {
+    Task &t = tasks.at(runTaskIndex.value());
+    if (t.onWake == Interrupt::preemptionPoint) {
+      return;
+    }
+    if (t.server) {
+      chargeServer(t);
     } else {
-      t.nextInterrupt = remainingDuration + timer.now();
-      t.onWake = Interrupt::taskComplete;
+      chargeSpare(t);
+      t.run(scaled(now() - latestCP));
+      latestCP = now();
     }
+    speed = target;
+    armRunner(t);
+    return;
   }
+  speed = target;
 }
 
-void Scheduler::loop() {
-  {
-    std::unique_lock<std::mutex> lk(interfaceMTX);
-    CV.wait(lk, [this]() {
-      return !this->incoming.empty() || !running || algoBuf;
-    });
+// Adds the energy drawn since the last call, at the power of the speed and
+// runner in effect since then.
+void Scheduler::accountEnergy() {
+  auto at = now();
+  double draw = runTaskIndex ? power.power(speed) : power.idlePower;
+  energyUsed += draw * std::chrono::duration<double>(at - energyAt).count();
+  energyAt = at;
+  if (metrics) {
+    MetricsData &m = metrics->data();
+    m.energyUs = static_cast<std::uint64_t>(energyUsed * 1e6);
+    m.speedPermille = static_cast<std::uint64_t>(speed * 1000);
+  }
+}
+
+// Runs the runner's coroutine on this thread until it finishes, the next
+// interrupt is due or the interface signals a change.
+void Scheduler::driveCoroutine(std::chrono::steady_clock::time_point until) {
+  int id = runTaskIndex.value();
+  CoroutineTask &c = coroutines.at(id);
+  slice.end = until;
+  slice.executed = c.executed;
+  slice.start = timer.now();
+  while (!c.job.done() && running &&
+         !slice.signalled.load(std::memory_order_relaxed) &&
+         timer.now() < until) {
+    c.job.resume();
+  }
+  c.executed += timer.now() - slice.start;
+  if (c.job.valid() && c.job.done()) {
+    finishJob(id, c.jobId, c.executed);
   }
-  if (!running) {
+}
+
+// Completion reported by a workload: the measured execution time replaces
+// the notional accounting. Stale reports from superseded jobs are dropped.
+void Scheduler::finishJob(int id, std::uint64_t job,
+                          std::chrono::steady_clock::duration executed) {
+  if (!tasks.contains(id)) {
     return;
   }
-  handleInterface();
-  latestCP = timer.now();
-  while (running) {
-    if (firedInterrupt) {
-      handleInterrupt(firedInterrupt.value());
-      firedInterrupt.reset();
-    }
-    selectRunner();
-    auto [wakeupTime, id, interrupt] = nextInterrupt();
-    firedInterrupt = {id, interrupt};
-    {
-      latestCP = timer.now();
-      if (wakeupTime < latestCP) {
-        handleInterface(); // for the very unlikely event;
-        continue;
-      }
-      std::unique_lock<std::mutex> lk(interfaceMTX);
-      if (CV.wait_until(lk, wakeupTime, [this]() {
-            return !this->incoming.empty() || !running ||
-                   !this->tasksToRemove.empty() || algoBuf;
-          })) {
-        if (!running)
-          break;
-        firedInterrupt = {0, Interrupt::taskEdited};
-      } else {
-      }
+  Task &t = tasks.at(id);
+  if (t.job != job || t.status == TaskStatus::completed) {
+    return;
+  }
+  t.runTime = t.runTime.zero();
+  t.run(executed);
+  t.status = TaskStatus::completed;
+  if (metrics) {
+    metrics->data().responseHist[latencyBucket(now() - t.refPoint)]++;
+  }
+  if (runTaskIndex == id) {
+    runTaskIndex.reset();
+  }
+  emit({EventType::complete, t.id});
+  armDeadline(t);
+}
+
+void Scheduler::emit(Event e) {
+  e.time = now();
+  if (trace) {
+    trace->push(e);
+  }
+  if (metrics) {
+    MetricsData &m = metrics->data();
+    switch (e.type) {
+    case EventType::start:
+      m.started++;
+      break;
+    case EventType::complete:
+      m.completed++;
+      break;
+    case EventType::preempt:
+      m.preempted++;
+      break;
+    case EventType::missed:
+      m.missed++;
+      break;
+    case EventType::initialize:
+    case EventType::restart:
+      m.released++;
+      break;
+    case EventType::block:
+      m.inversions++;
+      break;
+    case EventType::unblock:
+      break;
     }
   }
+  if (eventInterface) {
+    eventInterface(e);
+  }
+  bus.publish(e);
 }
 
-void Scheduler::removeTasks(std::vector<int> tasksId) {
-  {
-    std::lock_guard lk(interfaceMTX);
-    tasksToRemove.insert(tasksToRemove.end(), tasksId.begin(), tasksId.end());
+std::uint32_t Scheduler::queueDepth() {
+  return std::ranges::count_if(tasks, [](const auto &t) {
+    return t.second.status == TaskStatus::waiting;
+  });
+}
+
+void Scheduler::updateMetrics(std::uint32_t depth) {
+  if (!metrics) {
+    return;
   }
-  CV.notify_one();
+  MetricsData &m = metrics->data();
+  m.updatedAt =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now() - startTime)
+          .count();
+  m.runner = runTaskIndex.value_or(-1);
+  m.taskCount = tasks.size();
+  m.queueDepth = depth;
+  m.algo = static_cast<std::uint32_t>(algo);
+  metrics->publish();
 }
 
-void Scheduler::assignAlgo(SchedulingAlgo newAlgo) {
+bool Scheduler::pendingInterfaceLocked() {
+  std::lock_guard lk(interfaceMTX);
+  return pendingInterface();
+}
+
+bool Scheduler::pendingInterface() {
+  return !incoming.empty() || !tasksToRemove.empty() || !edits.empty() ||
+         algoBuf || metricsBuf || traceBuf || tableModeBuf || coalesceBuf ||
+         preemptionBuf || !incomingWorkloads.empty() || !finishedJobs.empty() ||
+         !incomingCoroutines.empty() || !snapshotRequests.empty() ||
+         !fences.empty() || slackPolicyBuf || !incomingExecTimes.empty() ||
+         !incomingJobs.empty() || protocolBuf || !incomingSections.empty() ||
+         dvfsBuf || compiledBuf;
+}
+
+void Scheduler::handleInterface() {
+  EDFSIM_PERF_SCOPE(handleInterface, tasks.size());
+  // Removals, workload bindings and finished jobs are applied after the lock
+  // is released: they may join or talk to executor threads that report back
+  // through interfaceMTX.
+  std::vector<int> removed;
+  std::vector<TaskEdit> edited;
+  std::vector<std::promise<std::shared_ptr<const Snapshot>>> snapshotted;
+  std::vector<std::promise<std::chrono::steady_clock::time_point>> fenced;
+  std::vector<std::pair<int, Workload>> workloads;
+  std::vector<std::pair<int, CoroutineBody>> bodies;
+  std::vector<std::pair<int, ExecutionTime>> execTimes;
+  std::vector<std::pair<int, std::vector<CriticalSection>>> sectionLists;
+  std::vector<std::tuple<int, std::chrono::steady_clock::time_point,
+                         std::chrono::milliseconds>>
+      jobs;
+  std::vector<std::tuple<int, std::uint64_t, std::chrono::steady_clock::duration>>
+      finished;
+  std::optional<CompiledTable> compiled;
+  int cpu;
   {
     std::lock_guard lk(interfaceMTX);
-    algoBuf = newAlgo;
+    if (!incoming.empty() || !tasksToRemove.empty() || !edits.empty() ||
+        algoBuf || tableModeBuf || coalesceBuf || preemptionBuf ||
+        slackPolicyBuf || !incomingWorkloads.empty() ||
+        !incomingCoroutines.empty() || !incomingExecTimes.empty() ||
+        protocolBuf || !incomingSections.empty() || dvfsBuf) {
+      nextCompile = {};
+      compileGeneration++;
+      compileFailures = 0;
+      pendingTable.reset();
+      staticSpeed.reset();
+    }
+    compiled.swap(compiledBuf);
+
+    if (!incoming.empty()) {
+      for (const auto &param : incoming) {
+        addTask(param);
+      }
+      incoming.clear();
+    }
+    for (const auto &[id, kind] : incomingServers) {
+      if (tasks.contains(id)) {
+        tasks.at(id).server = ServerState{kind};
+      }
+    }
+    incomingServers.clear();
+    removed.swap(tasksToRemove);
+    edited.swap(edits);
+    snapshotted.swap(snapshotRequests);
+    fenced.swap(fences);
+    workloads.swap(incomingWorkloads);
+    bodies.swap(incomingCoroutines);
+    execTimes.swap(incomingExecTimes);
+    sectionLists.swap(incomingSections);
+    jobs.swap(incomingJobs);
+    finished.swap(finishedJobs);
+    cpu = workerCPU;
+
+    if (algoBuf) {
+      algo = *algoBuf;
+      algoBuf.reset();
+    }
+    if (metricsBuf) {
+      metrics = std::move(metricsBuf);
+    }
+    if (traceBuf) {
+      trace = std::move(traceBuf);
+    }
+    if (tableModeBuf) {
+      tableMode = *tableModeBuf;
+      tableModeBuf.reset();
+    }
+    if (coalesceBuf) {
+      coalesceWindow = *coalesceBuf;
+      coalesceBuf.reset();
+    }
+    if (preemptionBuf) {
+      preemption = *preemptionBuf;
+      preemptionBuf.reset();
+    }
+    if (slackPolicyBuf) {
+      slackPolicy = *slackPolicyBuf;
+      slackPolicyBuf.reset();
+      spare.clear();
+      for (auto &[id, t] : tasks) {
+        t.background = false;
+      }
+      if (runTaskIndex && tasks.contains(runTaskIndex.value())) {
+        armRunner(tasks.at(runTaskIndex.value()));
+      }
+    }
+    if (protocolBuf) {
+      protocol = *protocolBuf;
+      protocolBuf.reset();
+    }
+    if (dvfsBuf) {
+      std::tie(dvfs, power) = std::move(*dvfsBuf);
+      dvfsBuf.reset();
+    }
+  }
+
+  if (compiled) {
+    finishCompile(std::move(*compiled));
+  }
+  for (int id : removed) {
+    deleteTask(id);
+  }
+  for (const TaskEdit &edit : edited) {
+    applyEdit(edit);
+  }
+  if (runTaskIndex && !tasks.contains(runTaskIndex.value())) {
+    runTaskIndex.reset();
+  }
+  for (auto &[id, model] : execTimes) {
+    if (tasks.contains(id)) {
+      tasks.at(id).execTime = std::move(model);
+    }
+  }
+  // A job in progress skips the sections it has already passed; one
+  // waiting at a section start retries the lock when next dispatched.
+  for (auto &[id, list] : sectionLists) {
+    auto it = tasks.find(id);
+    if (it == tasks.end()) {
+      continue;
+    }
+    Task &t = it->second;
+    if (t.holding) {
+      unlock(t);
+    }
+    t.blockedOn.reset();
+    t.sections = normalizeSections(std::move(list));
+    auto progress = t.runTime - t.overhead;
+    t.section = std::ranges::count_if(
+        t.sections, [progress](const CriticalSection &s) {
+          return s.start < progress;
+        });
+    if (t.status == TaskStatus::running) {
+      armRunner(t);
+    }
+  }
+  for (const auto &[id, arrival, work] : jobs) {
+    auto it = tasks.find(id);
+    if (it != tasks.end() && it->second.server) {
+      enqueueJob(it->second, {arrival, work});
+    }
+  }
+  for (auto &[id, body] : workloads) {
+    if (!executor) {
+      executor = std::make_unique<Executor>(
+          [this](int id, std::uint64_t job,
+                 std::chrono::steady_clock::duration executed) {
+            {
+              std::lock_guard lk(interfaceMTX);
+              finishedJobs.emplace_back(id, job, executed);
+            }
+            wake();
+          },
+          cpu);
+    }
+    executor->bind(id, std::move(body));
+    if (tasks.contains(id)) {
+      Task &t = tasks.at(id);
+      executor->release(id, t.job);
+      if (t.status == TaskStatus::running) {
+        executor->dispatch(id);
+        armRunner(t);
+      }
+    }
+  }
+  for (auto &[id, body] : bodies) {
+    coroutines[id] = {std::move(body)};
+    if (tasks.contains(id)) {
+      Task &t = tasks.at(id);
+      if (t.status != TaskStatus::uninitialized) {
+        releaseJob(t);
+      }
+      if (t.status == TaskStatus::running) {
+        armRunner(t);
+      }
+    }
+  }
+  for (const auto &[id, job, executed] : finished) {
+    finishJob(id, job, executed);
+  }
+  if (!snapshotted.empty()) {
+    auto snap = snapshot();
+    for (auto &request : snapshotted) {
+      request.set_value(snap);
+    }
+  }
+  if (!fenced.empty()) {
+    auto applied = std::chrono::steady_clock::now();
+    for (auto &fence : fenced) {
+      fence.set_value(applied);
+    }
+  }
+}
+
+void Scheduler::initTasks(
+    std::span<const TaskParams> paramVector,
+    std::optional<std::chrono::steady_clock::time_point> at) {
+  auto origin = at.value_or(now());
+  {
+    std::lock_guard lk(interfaceMTX);
+    incoming.reserve(incoming.size() + paramVector.size());
+    for (const TaskParams &params : paramVector) {
+      incoming.emplace_back(
+          params, origin + std::chrono::milliseconds(params.delay), nextId);
+      nextId++;
+    }
+  }
+  wake();
+}
+
+std::tuple<std::chrono::steady_clock::time_point, int, Interrupt>
+Scheduler::nextInterrupt() {
+  EDFSIM_PERF_SCOPE(nextInterrupt, tasks.size());
+  if (tasks.empty()) {
+    return {now() + std::chrono::days(2), -1, Interrupt::taskInit};
+  }
+
+  const auto it = std::ranges::min_element(
+      tasks, {}, [](const auto t) { return t.second.nextInterrupt; });
+  const auto &[id, task] = *it;
+  // Waits for the last interrupt due within the coalescing window, so the
+  // batch is handled together without handling any of it early.
+  auto wakeupTime = task.nextInterrupt;
+  if (coalesceWindow > coalesceWindow.zero()) {
+    auto horizon = task.nextInterrupt + coalesceWindow;
+    for (const auto &[otherId, other] : tasks) {
+      if (other.nextInterrupt <= horizon) {
+        wakeupTime = std::max(wakeupTime, other.nextInterrupt);
+      }
+    }
+  }
+  return {wakeupTime, id, task.onWake};
+}
+
+void Scheduler::handleInterrupt(std::tuple<int, Interrupt> firedInterrupt) {
+  const auto &[id, interrupt] = firedInterrupt;
+  if (interrupt != Interrupt::taskEdited) {
+    auto it = tasks.find(id);
+    if (it != tasks.end() && it->second.server) {
+      serverInterrupt(it->second, interrupt);
+      return;
+    }
+  }
+
+  switch (interrupt) {
+  case Interrupt::taskInit: {
+    if (!tasks.contains(id)) {
+      return;
+    }
+    Task &t = tasks.at(id);
+    t.status = TaskStatus::waiting;
+    t.refPoint = t.arrival;
+    t.deadline = t.refPoint + t.relativeDeadline();
+    scheduleRelease(t, t.refPoint + t.period);
+    t.job++;
+    drawDemand(t);
+    releaseJob(t);
+    emit({EventType::initialize, t.id});
+    armDeadline(t);
+  } break;
+  case Interrupt::taskRestart: {
+    if (!tasks.contains(id)) {
+      return;
+    }
+    Task &t = tasks.at(id);
+    t.refPoint = t.arrival;
+    if (t.holding) {
+      unlock(t);
+    }
+    if (t.status != TaskStatus::completed) {
+      if (t.status == TaskStatus::running) {
+        chargeSpare(t);
+        runTaskIndex.reset();
+      }
+      emit({EventType::missed, t.id});
+    }
+    emit({EventType::restart, t.id});
+    if (t.nextParams) {
+      std::tie(t.period, t.duration) = *t.nextParams;
+      t.nextParams.reset();
+      staticSpeed.reset();
+    }
+    t.status = TaskStatus::waiting;
+    t.runTime = t.runTime.zero();
+    t.overhead = t.overhead.zero();
+    t.preempted = false;
+    t.atPoint = false;
+    t.section = 0;
+    t.dispatched = false;
+    t.blockedOn.reset();
+    t.deadline = t.refPoint + t.relativeDeadline();
+    scheduleRelease(t, t.refPoint + t.period);
+    t.job++;
+    drawDemand(t);
+    releaseJob(t);
+    armDeadline(t);
+    break;
+  }
+  // Under a constrained deadline or jitter the job is dropped at its
+  // deadline, as it would be at the next release, and the task idles until
+  // then.
+  case Interrupt::deadlineMissed: {
+    if (!tasks.contains(id)) {
+      return;
+    }
+    Task &t = tasks.at(id);
+    if (t.holding) {
+      unlock(t);
+    }
+    if (t.status == TaskStatus::running) {
+      chargeSpare(t);
+      runTaskIndex.reset();
+      if (onWorker(t.id)) {
+        executor->preempt(t.id);
+      }
+    }
+    t.status = TaskStatus::completed;
+    t.section = 0;
+    t.dispatched = false;
+    t.blockedOn.reset();
+    emit({EventType::missed, t.id});
+    armDeadline(t);
+  } break;
+  case Interrupt::taskComplete: {
+    if (!tasks.contains(id)) {
+      return;
+    }
+    Task &t = tasks.at(id);
+    chargeSpare(t);
+    t.run(scaled(now() - latestCP));
+    if (t.holding) {
+      unlock(t);
+    }
+    t.status = TaskStatus::completed;
+    if (metrics) {
+      metrics->data().responseHist[latencyBucket(now() - t.refPoint)]++;
+    }
+    if (slackPolicy == SlackPolicy::donate) {
+      donateSlack(t);
+    }
+    runTaskIndex.reset();
+    emit({EventType::complete, t.id});
+    armDeadline(t);
+    break;
+  }
+  case Interrupt::taskEdited:
+    handleInterface();
+    break;
+  case Interrupt::preemptionPoint: {
+    if (!tasks.contains(id)) {
+      return;
+    }
+    Task &t = tasks.at(id);
+    t.atPoint = true;
+    armRunner(t);
+  } break;
+  case Interrupt::budgetExhausted: {
+    if (!tasks.contains(id)) {
+      return;
+    }
+    Task &t = tasks.at(id);
+    t.run(scaled(now() - latestCP));
+    latestCP = now();
+    claimSlack(t);
+    armRunner(t);
+  } break;
+  case Interrupt::sectionBoundary: {
+    if (!tasks.contains(id)) {
+      return;
+    }
+    Task &t = tasks.at(id);
+    chargeSpare(t);
+    t.run(scaled(now() - latestCP));
+    latestCP = now();
+    if (t.holding) {
+      unlock(t);
+      t.section++;
+    } else {
+      lock(t);
+    }
+    if (t.status == TaskStatus::running) {
+      armRunner(t);
+    }
+  } break;
+  }
+}
+
+void Scheduler::selectRunner() {
+  EDFSIM_PERF_SCOPE(selectRunner, tasks.size());
+  if (tasks.empty()) {
+    return;
+  }
+  // Under SRP a job may only start above the system ceiling, the highest
+  // ceiling of the resources held right now.
+  long systemCeiling = std::numeric_limits<long>::min();
+  if (protocol == LockProtocol::stackResource) {
+    for (const auto &[id, t] : tasks) {
+      if (t.holding) {
+        systemCeiling = std::max(systemCeiling,
+                                 ceiling(t.sections[t.section].resource));
+      }
+    }
+  }
+  auto filtered =
+      tasks | std::views::filter([systemCeiling](const auto &t) {
+        return (t.second.status == TaskStatus::waiting ||
+                t.second.status == TaskStatus::running) &&
+               !t.second.blockedOn &&
+               (t.second.dispatched ||
+                -t.second.relativeDeadline().count() > systemCeiling);
+      });
+
+  if (std::ranges::empty(filtered)) {
+    runTaskIndex.reset();
+    return;
+  }
+
+  auto priority = [this](const Task &t) -> std::chrono::steady_clock::duration {
+    if (t.background) {
+      return std::chrono::steady_clock::duration::max();
+    }
+    switch (algo) {
+    case SchedulingAlgo::EDF:
+      return t.deadline > now() ? t.deadline - now()
+                                : std::chrono::milliseconds::max();
+    case SchedulingAlgo::RMS:
+      return t.period;
+    case SchedulingAlgo::DM:
+      return t.relativeDeadline();
+    }
+    return t.period;
+  };
+  // Under inheritance and ceiling a holder runs at the best priority of
+  // the jobs it blocks.
+  bool inherit = protocol == LockProtocol::inheritance ||
+                 protocol == LockProtocol::ceiling;
+  auto it = std::ranges::min_element(
+      filtered, {}, [&](const auto &t) -> std::chrono::steady_clock::duration {
+        auto key = priority(t.second);
+        if (inherit && t.second.holding) {
+          for (const auto &[id, other] : tasks) {
+            if (other.blockedOn == t.first) {
+              key = std::min(key, priority(other));
+            }
+          }
+        }
+        return key;
+      });
+
+  const auto &[id, task] = *it;
+
+  if (id != runTaskIndex) {
+    if (runTaskIndex) {
+      Task &oldRunner = tasks.at(runTaskIndex.value());
+      if (preemption.mode != PreemptionMode::full && !oldRunner.atPoint) {
+        armPreemptionPoint(oldRunner);
+        return;
+      }
+      if (oldRunner.server) {
+        chargeServer(oldRunner);
+      } else {
+        chargeSpare(oldRunner);
+        oldRunner.run(scaled(now() - latestCP));
+      }
+      oldRunner.status = TaskStatus::waiting;
+      oldRunner.preempted = true;
+      oldRunner.atPoint = false;
+      armDeadline(oldRunner);
+      if (onWorker(oldRunner.id)) {
+        executor->preempt(oldRunner.id);
+      }
+      emit({EventType::preempt, oldRunner.id});
+      if (oldRunner.server) {
+        armServer(oldRunner);
+      }
+    }
+    runTaskIndex = id;
+    latestCP = now();
+    Task &t = tasks.at(id);
+    t.status = TaskStatus::running;
+    t.dispatched = true;
+    if (metrics && !t.server && t.runTime == t.runTime.zero()) {
+      metrics->data().dispatchHist[latencyBucket(now() - t.refPoint)]++;
+    }
+    auto cost = preemption.contextSwitch +
+                (t.preempted ? preemption.cacheRefill
+                             : std::chrono::milliseconds::zero());
+    t.overhead += cost;
+    t.preempted = false;
+    if (metrics) {
+      metrics->data().overheadUs +=
+          std::chrono::duration_cast<std::chrono::microseconds>(cost).count();
+    }
+
+    emit({EventType::start, t.id});
+    if (onWorker(id)) {
+      executor->dispatch(id);
+    }
+    armRunner(t);
+  }
+  if (runTaskIndex) {
+    tasks.at(runTaskIndex.value()).atPoint = false;
+  }
+}
+
+// Points the runner's interrupt at whichever comes first: the end of its
+// remaining work (overhead included), the end of its budget when budgets are
+// enforced, its next critical section boundary, or its deadline. Tasks with
+// a workload report their own completion, so only the deadline is armed for
+// them.
+void Scheduler::armRunner(Task &t) {
+  if (t.server) {
+    armServer(t);
+    return;
+  }
+  if (executes(t.id)) {
+    armDeadline(t);
+    return;
+  }
+  auto wakeup = latestCP + wallTime(work(t) + t.overhead - t.runTime);
+  auto onWake = Interrupt::taskComplete;
+  if (slackPolicy == SlackPolicy::donate && !t.background) {
+    auto exhausted =
+        latestCP + wallTime(t.duration + t.granted + t.overhead - t.runTime);
+    if (exhausted < wakeup) {
+      wakeup = exhausted;
+      onWake = Interrupt::budgetExhausted;
+    }
+  }
+  if (t.section < t.sections.size()) {
+    const CriticalSection &s = t.sections[t.section];
+    auto boundary = t.holding ? s.start + s.length : s.start;
+    auto at = latestCP + wallTime(boundary + t.overhead - t.runTime);
+    if (at < wakeup) {
+      wakeup = at;
+      onWake = Interrupt::sectionBoundary;
+    }
+  }
+  if (t.deadline < wakeup) {
+    armDeadline(t);
+  } else {
+    t.nextInterrupt = wakeup;
+    t.onWake = onWake;
+  }
+}
+
+// Called when a better task is ready but the runner may not be preempted
+// yet: wakes the scheduler at the runner's next permitted preemption point.
+void Scheduler::armPreemptionPoint(Task &runner) {
+  if (runner.onWake == Interrupt::preemptionPoint) {
+    return;
+  }
+  std::chrono::steady_clock::time_point point;
+  switch (preemption.mode) {
+  case PreemptionMode::deferred:
+    point = now() + preemption.quantum;
+    break;
+  case PreemptionMode::fixedPoints: {
+    if (preemption.quantum <= preemption.quantum.zero()) {
+      return;
+    }
+    auto executed = runner.runTime + scaled(now() - latestCP);
+    auto next = (executed / preemption.quantum + 1) * preemption.quantum;
+    point = latestCP + wallTime(next - runner.runTime);
+  } break;
+  default:
+    return;
+  }
+  if (point < runner.nextInterrupt) {
+    runner.nextInterrupt = point;
+    runner.onWake = Interrupt::preemptionPoint;
+  }
+}
+
+// Handles every task interrupt already due as one batch, in time order, so
+// synchronous releases cost a single selectRunner. nextInterrupt holds the
+// wakeup until the whole coalescing window is due. Each task is handled at
+// most once per batch.
+void Scheduler::handleDue() {
+  auto horizon = now();
+  std::vector<std::tuple<std::chrono::steady_clock::time_point, int, Interrupt>>
+      due;
+  for (const auto &[id, t] : tasks) {
+    if (t.nextInterrupt <= horizon) {
+      due.emplace_back(t.nextInterrupt, id, t.onWake);
+    }
+  }
+  std::ranges::sort(due);
+  for (const auto &[wakeupTime, id, interrupt] : due) {
+    lastDue = std::max(lastDue, wakeupTime);
+    handleInterrupt({id, interrupt});
+  }
+}
+
+void Scheduler::step() {
+  accountEnergy();
+  if (firedInterrupt) {
+    if (std::get<Interrupt>(*firedInterrupt) == Interrupt::taskEdited) {
+      handleInterrupt(firedInterrupt.value());
+    }
+    firedInterrupt.reset();
+    handleDue();
+  }
+  selectRunner();
+  adjustSpeed();
+  trackInversions();
+}
+
+void Scheduler::runUntil(std::chrono::steady_clock::time_point horizon,
+                         std::function<bool()> afterStep) {
+  while (true) {
+    EDFSIM_PERF_SCOPE(loop, tasks.size());
+    auto [wakeupTime, id, interrupt] = nextInterrupt();
+    if (wakeupTime > horizon) {
+      break;
+    }
+    virtualNow = std::max(now(), wakeupTime);
+    firedInterrupt = {id, interrupt};
+    step();
+    if (afterStep && !afterStep()) {
+      break;
+    }
+  }
+}
+
+void Scheduler::copyConfig(const Scheduler &other) {
+  coalesceWindow = other.coalesceWindow;
+  preemption = other.preemption;
+  slackPolicy = other.slackPolicy;
+  protocol = other.protocol;
+  dvfs = other.dvfs;
+  power = other.power;
+}
+
+std::optional<std::chrono::milliseconds> Scheduler::computeHyperperiod() {
+  long long lcm = 1;
+  for (const auto &[id, t] : tasks) {
+    if (t.period.count() <= 0) {
+      return std::nullopt;
+    }
+    lcm = std::lcm(lcm, static_cast<long long>(t.period.count()));
+    if (lcm > std::chrono::milliseconds(maxHyperperiod).count()) {
+      return std::nullopt;
+    }
+  }
+  return std::chrono::milliseconds(lcm);
+}
+
+ScheduleState Scheduler::captureState() {
+  return {tasks, runTaskIndex, latestCP, spare, speed};
+}
+
+void Scheduler::restoreState(ScheduleState state,
+                             std::chrono::steady_clock::duration shift) {
+  tasks = std::move(state.tasks);
+  for (auto &[id, t] : tasks) {
+    t.nextInterrupt += shift;
+    t.deadline += shift;
+    t.refPoint += shift;
+    t.arrival += shift;
+    t.release += shift;
+    if (t.blockedSince) {
+      *t.blockedSince += shift;
+    }
+  }
+  runTaskIndex = state.runTaskIndex;
+  latestCP = state.latestCP + shift;
+  spare = std::move(state.spare);
+  for (SpareCapacity &c : spare) {
+    c.deadline += shift;
+  }
+  speed = state.speed;
+  staticSpeed.reset();
+}
+
+bool Scheduler::matchesState(const ScheduleState &other,
+                             std::chrono::steady_clock::duration shift) {
+  if (tasks.size() != other.tasks.size() ||
+      runTaskIndex != other.runTaskIndex || speed != other.speed) {
+    return false;
+  }
+  if (runTaskIndex && latestCP != other.latestCP + shift) {
+    return false;
+  }
+  if (!std::ranges::equal(spare, other.spare, {}, {},
+                          [shift](SpareCapacity c) {
+                            c.deadline += shift;
+                            return c;
+                          })) {
+    return false;
+  }
+  for (const auto &[id, t] : tasks) {
+    auto it = other.tasks.find(id);
+    if (it == other.tasks.end()) {
+      return false;
+    }
+    const Task &o = it->second;
+    if (t.status != o.status || t.onWake != o.onWake ||
+        t.runTime != o.runTime || t.overhead != o.overhead ||
+        t.preempted != o.preempted || t.atPoint != o.atPoint ||
+        t.period != o.period || t.nextParams != o.nextParams ||
+        t.duration != o.duration || t.demand != o.demand ||
+        t.granted != o.granted || t.background != o.background ||
+        t.section != o.section || t.holding != o.holding ||
+        t.dispatched != o.dispatched || t.blockedOn != o.blockedOn ||
+        t.blockedSince.has_value() != o.blockedSince.has_value() ||
+        t.nextInterrupt != o.nextInterrupt + shift ||
+        t.deadline != o.deadline + shift || t.refPoint != o.refPoint + shift ||
+        t.arrival != o.arrival + shift || t.release != o.release + shift ||
+        t.deadlineParam != o.deadlineParam) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Simulates two hyperperiods from a copy of the current state in virtual
+// time, on the compiler thread so live dispatch carries on meanwhile. The
+// first one absorbs the start-up transient and the jitter of the live
+// state; if the second one ends in the state it started from, it repeats
+// forever and its recorded decisions become the dispatch table.
+void Scheduler::compileTable() {
+  nextCompile = std::chrono::steady_clock::time_point::max();
+  auto period = computeHyperperiod();
+  if (!period || tasks.empty()) {
+    return;
+  }
+  if (std::ranges::any_of(tasks, [this](const auto &t) {
+        return executes(t.first) || t.second.server ||
+               t.second.jitter > t.second.jitter.zero() ||
+               !t.second.sections.empty() || dvfs != DvfsPolicy::off ||
+               (slackPolicy != SlackPolicy::none && !t.second.execTime.fixed());
+      })) {
+    return;
+  }
+  if (std::ranges::any_of(tasks, [](const auto &t) {
+        return t.second.status == TaskStatus::uninitialized;
+      })) {
+    nextCompile = {};
+    return;
+  }
+
+  auto recorded = std::make_shared<std::vector<Event>>();
+  auto shadow = std::make_unique<Scheduler>(
+      algo, [recorded](Event e) { recorded->push_back(e); });
+  shadow->copyConfig(*this);
+  shadow->virtualNow = now();
+  shadow->restoreState(captureState());
+  CompiledTable out;
+  out.generation = compileGeneration;
+  out.start = now();
+  out.hyperperiod = *period;
+  compiling = true;
+  compiler = std::jthread([this, shadow = std::move(shadow), recorded,
+                           out = std::move(out)](std::stop_token stop) mutable {
+    CompiledTable result =
+        simulateTable(*shadow, *recorded, std::move(out), stop);
+    if (stop.stop_requested()) {
+      return;
+    }
+    {
+      std::lock_guard lk(interfaceMTX);
+      compiledBuf = std::move(result);
+    }
+    wake();
+  });
+}
+
+// Runs on the compiler thread. Stops as soon as the table outgrows its cap
+// or the scheduler goes away, rather than simulating the rest.
+CompiledTable Scheduler::simulateTable(Scheduler &shadow,
+                                       std::vector<Event> &recorded,
+                                       CompiledTable out,
+                                       std::stop_token stop) {
+  std::vector<DispatchEntry> compiled;
+  auto record = [&]() {
+    if (!recorded.empty()) {
+      auto offset = shadow.now() - out.start;
+      if (compiled.empty() || compiled.back().offset != offset) {
+        compiled.push_back({offset});
+      }
+      DispatchEntry &entry = compiled.back();
+      entry.events.insert(entry.events.end(), recorded.begin(),
+                          recorded.end());
+      entry.runner = shadow.runTaskIndex;
+      entry.queueDepth = shadow.queueDepth();
+      recorded.clear();
+    }
+    out.capped = compiled.size() > maxTableEntries;
+    return !out.capped && !stop.stop_requested();
+  };
+
+  shadow.runUntil(out.start + out.hyperperiod, record);
+  std::size_t settledAt = compiled.size();
+  out.settled = shadow.captureState();
+  if (out.capped || stop.stop_requested()) {
+    return out;
+  }
+  shadow.runUntil(out.start + 2 * out.hyperperiod, record);
+  if (out.capped || stop.stop_requested() || settledAt == compiled.size() ||
+      !shadow.matchesState(out.settled, out.hyperperiod)) {
+    return out;
+  }
+  out.entries.assign(std::make_move_iterator(compiled.begin() + settledAt),
+                     std::make_move_iterator(compiled.end()));
+  return out;
+}
+
+// Takes a result off the compiler thread. One from before the last change
+// is stale and a recompile is already due. A table over the cap stays over
+// it; a schedule that did not repeat may still settle, so it is retried
+// after twice as many hyperperiods each time, up to maxCompileAttempts.
+void Scheduler::finishCompile(CompiledTable result) {
+  compiling = false;
+  if (result.generation != compileGeneration || !tableMode) {
+    return;
+  }
+  if (!result.entries.empty()) {
+    pendingTable = std::move(result);
+    return;
+  }
+  if (result.capped || ++compileFailures >= maxCompileAttempts) {
+    nextCompile = std::chrono::steady_clock::time_point::max();
+  } else {
+    nextCompile = result.start + result.hyperperiod * (1 << compileFailures);
+  }
+}
+
+// Switches to the pending table at its first loop boundary,
+// start + k * hyperperiod, that the live schedule has handled everything up
+// to and nothing past. The live run got there on the wall clock, so if it
+// decided differently from the simulation the table is dropped instead.
+bool Scheduler::installTable() {
+  CompiledTable &compiled = *pendingTable;
+  auto start = compiled.start;
+  auto period = compiled.hyperperiod;
+  auto laps = std::max<std::chrono::steady_clock::duration::rep>(
+      1, (lastDue - start + period - std::chrono::steady_clock::duration(1)) /
+             period);
+  auto boundary = start + laps * period;
+  if (std::get<0>(nextInterrupt()) <= boundary) {
+    return false;
+  }
+  auto decision = [](const auto &t) {
+    return std::tuple(t.first, t.second.status, t.second.job);
+  };
+  if (runTaskIndex != compiled.settled.runTaskIndex ||
+      !std::ranges::equal(tasks, compiled.settled.tasks, {}, decision,
+                          decision)) {
+    pendingTable.reset();
+    finishCompile({compileGeneration, start, period});
+    return false;
+  }
+  restoreState(std::move(compiled.settled), boundary - (start + period));
+  table = std::move(compiled.entries);
+  pendingTable.reset();
+  tableIndex = 0;
+  loopStart = 0;
+  hyperperiod = period;
+  tableBase = boundary - period;
+  lastEmitted = boundary;
+  anchorTime = tableBase;
+  anchor = captureState();
+  loopAnchor = anchor;
+  return true;
+}
+
+// Replays the next table entry if it is due, otherwise returns when it is.
+std::optional<std::chrono::steady_clock::time_point> Scheduler::walkTable() {
+  const DispatchEntry &entry = table[tableIndex];
+  auto wakeupTime = tableBase + entry.offset;
+  if (now() < wakeupTime) {
+    return wakeupTime;
+  }
+  for (const Event &e : entry.events) {
+    emit(e);
+  }
+  lastEmitted = wakeupTime;
+  accountEnergy();
+  runTaskIndex = entry.runner;
+  updateMetrics(entry.queueDepth);
+  if (++tableIndex == table.size()) {
+    tableIndex = loopStart;
+    tableBase += hyperperiod;
+  }
+  return std::nullopt;
+}
+
+// Rebuilds the live task state at the last replayed instant by
+// fast-forwarding the nearest anchor, so dynamic scheduling resumes exactly
+// where the table left off.
+void Scheduler::leaveTable() {
+  Scheduler shadow(algo);
+  shadow.copyConfig(*this);
+  auto loopTime = anchorTime + hyperperiod;
+  if (lastEmitted < loopTime) {
+    shadow.virtualNow = anchorTime;
+    shadow.restoreState(std::move(anchor));
+  } else {
+    auto shift = (lastEmitted - loopTime) / hyperperiod * hyperperiod;
+    shadow.virtualNow = loopTime + shift;
+    shadow.restoreState(std::move(loopAnchor), shift);
+  }
+  shadow.runUntil(lastEmitted);
+
+  restoreState(shadow.captureState());
+  table.clear();
+  anchor = {};
+  loopAnchor = {};
+  nextCompile = {};
+}
+
+// Does everything that is due and returns when the scheduler next needs to
+// run, or time_point::max() if only the interface can wake it. loop() blocks
+// on the returned time; SchedulerHost queues it instead.
+std::chrono::steady_clock::time_point Scheduler::poll() {
+  EDFSIM_PERF_SCOPE(loop, tasks.size());
+  if (pendingInterfaceLocked()) {
+    firedInterrupt = {0, Interrupt::taskEdited};
+  }
+  while (running) {
+    if (!table.empty()) {
+      if (pendingInterfaceLocked()) {
+        leaveTable();
+        firedInterrupt = {0, Interrupt::taskEdited};
+      } else if (auto wakeupTime = walkTable()) {
+        return *wakeupTime;
+      } else {
+        continue;
+      }
+    }
+    step();
+    updateMetrics(queueDepth());
+    if (pendingTable && installTable()) {
+      continue;
+    }
+    if (tableMode && !compiling && now() >= nextCompile) {
+      compileTable();
+    }
+    auto [wakeupTime, id, interrupt] = nextInterrupt();
+    firedInterrupt = {id, interrupt};
+    if (runTaskIndex && coroutines.contains(runTaskIndex.value())) {
+      slice.signalled = false;
+      if (pendingInterfaceLocked()) {
+        firedInterrupt = {0, Interrupt::taskEdited};
+        continue;
+      }
+      driveCoroutine(wakeupTime);
+      if (slice.signalled.exchange(false)) {
+        firedInterrupt = {0, Interrupt::taskEdited};
+      }
+      continue;
+    }
+    if (wakeupTime < now()) {
+      handleInterface(); // for the very unlikely event;
+      continue;
+    }
+    return wakeupTime;
+  }
+  return std::chrono::steady_clock::time_point::max();
+}
+
+void Scheduler::useVirtualTime(std::uint64_t seed) {
+  virtualNow = std::chrono::steady_clock::time_point{};
+  startTime = *virtualNow;
+  energyAt = *virtualNow;
+  // Simulated instants are exact; setCoalesceWindow can still opt in.
+  coalesceWindow = coalesceWindow.zero();
+  rng.seed(seed);
+}
+
+// Applies whatever the interface staged since the last call, then replays
+// every interrupt due within span in virtual time.
+void Scheduler::runFor(std::chrono::steady_clock::duration span) {
+  if (!virtualNow) {
+    return;
+  }
+  auto horizon = *virtualNow + span;
+  if (pendingInterfaceLocked()) {
+    firedInterrupt = {0, Interrupt::taskEdited};
+  }
+  step();
+  runUntil(horizon);
+  virtualNow = horizon;
+}
+
+std::shared_ptr<const Snapshot> Scheduler::snapshot() {
+  int id;
+  {
+    std::lock_guard lk(interfaceMTX);
+    id = nextId;
+  }
+  return std::make_shared<const Snapshot>(
+      Snapshot{captureState(), algo, preemption, coalesceWindow, slackPolicy,
+               protocol, dvfs, power, id, now(), rng});
+}
+
+std::future<std::shared_ptr<const Snapshot>> Scheduler::requestSnapshot() {
+  std::future<std::shared_ptr<const Snapshot>> result;
+  {
+    std::lock_guard lk(interfaceMTX);
+    result = snapshotRequests.emplace_back().get_future();
+  }
+  wake();
+  return result;
+}
+
+std::future<std::chrono::steady_clock::time_point> Scheduler::fence() {
+  std::future<std::chrono::steady_clock::time_point> result;
+  {
+    std::lock_guard lk(interfaceMTX);
+    result = fences.emplace_back().get_future();
+  }
+  wake();
+  return result;
+}
+
+void Scheduler::restore(const Snapshot &snap) {
+  virtualNow = snap.at;
+  startTime = snap.at;
+  energyAt = snap.at;
+  restoreState(snap.state);
+  algo = snap.algo;
+  preemption = snap.preemption;
+  coalesceWindow = snap.coalesceWindow;
+  slackPolicy = snap.slackPolicy;
+  protocol = snap.protocol;
+  dvfs = snap.dvfs;
+  power = snap.power;
+  rng = snap.rng;
+  std::lock_guard lk(interfaceMTX);
+  nextId = snap.nextId;
+}
+
+void Scheduler::loop() {
+  while (running) {
+    auto wakeupTime = poll();
+    std::unique_lock<std::mutex> lk(interfaceMTX);
+    auto woken = [this]() { return pendingInterface() || !running; };
+    if (wakeupTime == std::chrono::steady_clock::time_point::max()) {
+      CV.wait(lk, woken);
+    } else {
+      CV.wait_until(lk, wakeupTime, woken);
+    }
+  }
+  // Nobody will answer these any more; waiters get broken_promise.
+  std::lock_guard lk(interfaceMTX);
+  snapshotRequests.clear();
+  fences.clear();
+}
+
+// Returns the id given to the first added task; the rest follow in order.
+int Scheduler::commit(const Transaction &tx) {
+  int firstId;
+  auto origin = tx.at.value_or(now());
+  {
+    std::lock_guard lk(interfaceMTX);
+    firstId = nextId;
+    incoming.reserve(incoming.size() + tx.adds.size());
+    for (const TaskParams &params : tx.adds) {
+      incoming.emplace_back(
+          params, origin + std::chrono::milliseconds(params.delay), nextId);
+      nextId++;
+    }
+    tasksToRemove.insert(tasksToRemove.end(), tx.removes.begin(),
+                         tx.removes.end());
+    edits.insert(edits.end(), tx.edits.begin(), tx.edits.end());
+    if (tx.algo) {
+      algoBuf = tx.algo;
+    }
+  }
+  if (!tx.empty()) {
+    wake();
+  }
+  return firstId;
+}
+
+void Scheduler::removeTasks(std::vector<int> tasksId) {
+  {
+    std::lock_guard lk(interfaceMTX);
+    tasksToRemove.insert(tasksToRemove.end(), tasksId.begin(), tasksId.end());
+  }
+  wake();
+}
+
+void Scheduler::editTask(int id, long period, long duration, EditMode mode) {
+  {
+    std::lock_guard lk(interfaceMTX);
+    edits.push_back({id, period, duration, mode});
+  }
+  wake();
+}
+
+void Scheduler::assignAlgo(SchedulingAlgo newAlgo) {
+  {
+    std::lock_guard lk(interfaceMTX);
+    algoBuf = newAlgo;
+  }
+  wake();
+}
+
+void Scheduler::publishMetrics(std::string name) {
+  auto segment = std::make_unique<MetricsSegment>(std::move(name));
+  if (!segment->ok()) {
+    return;
+  }
+  {
+    std::lock_guard lk(interfaceMTX);
+    metricsBuf = std::move(segment);
+  }
+  wake();
+}
+
+void Scheduler::traceTo(const std::filesystem::path &path) {
+  auto writer = std::make_unique<TraceWriter>(path, startTime);
+  if (!writer->ok()) {
+    return;
+  }
+  {
+    std::lock_guard lk(interfaceMTX);
+    traceBuf = std::move(writer);
+  }
+  wake();
+}
+
+void Scheduler::useDispatchTable(bool enable) {
+  {
+    std::lock_guard lk(interfaceMTX);
+    tableModeBuf = enable;
+  }
+  wake();
+}
+
+void Scheduler::setCoalesceWindow(std::chrono::microseconds window) {
+  {
+    std::lock_guard lk(interfaceMTX);
+    coalesceBuf = std::max(window, std::chrono::microseconds::zero());
+  }
+  wake();
+}
+
+void Scheduler::setPreemptionModel(PreemptionModel model) {
+  {
+    std::lock_guard lk(interfaceMTX);
+    preemptionBuf = model;
+  }
+  wake();
+}
+
+void Scheduler::setExecutionTime(int id, ExecutionTime model) {
+  {
+    std::lock_guard lk(interfaceMTX);
+    incomingExecTimes.emplace_back(id, std::move(model));
+  }
+  wake();
+}
+
+void Scheduler::setSlackPolicy(SlackPolicy policy) {
+  {
+    std::lock_guard lk(interfaceMTX);
+    slackPolicyBuf = policy;
+  }
+  wake();
+}
+
+int Scheduler::addServer(
+    ServerKind kind, long budget, long period,
+    std::optional<std::chrono::steady_clock::time_point> at) {
+  int id;
+  auto origin = at.value_or(now());
+  {
+    std::lock_guard lk(interfaceMTX);
+    id = nextId++;
+    incoming.emplace_back(TaskParams{period, budget}, origin, id);
+    incomingServers.emplace_back(id, kind);
+  }
+  wake();
+  return id;
+}
+
+void Scheduler::submit(int server, std::chrono::milliseconds work) {
+  submit(server, std::span(&work, 1));
+}
+
+void Scheduler::submit(int server,
+                       std::span<const std::chrono::milliseconds> work) {
+  auto arrival = now();
+  bool first;
+  {
+    std::lock_guard lk(interfaceMTX);
+    first = incomingJobs.empty();
+    for (auto w : work) {
+      incomingJobs.emplace_back(server, arrival, w);
+    }
+  }
+  if (first) {
+    wake();
+  }
+}
+
+std::optional<ResponseHistogram> Scheduler::serverResponses(int server) {
+  auto it = tasks.find(server);
+  if (it == tasks.end() || !it->second.server) {
+    return std::nullopt;
+  }
+  return it->second.server->responses;
+}
+
+void Scheduler::setCriticalSections(int id,
+                                    std::vector<CriticalSection> sections) {
+  {
+    std::lock_guard lk(interfaceMTX);
+    incomingSections.emplace_back(id, std::move(sections));
+  }
+  wake();
+}
+
+void Scheduler::setLockProtocol(LockProtocol newProtocol) {
+  {
+    std::lock_guard lk(interfaceMTX);
+    protocolBuf = newProtocol;
+  }
+  wake();
+}
+
+void Scheduler::setDvfs(DvfsPolicy policy, PowerModel model) {
+  {
+    std::lock_guard lk(interfaceMTX);
+    dvfsBuf = {policy, std::move(model)};
+  }
+  wake();
+}
+
+double Scheduler::energy() {
+  double draw = runTaskIndex ? power.power(speed) : power.idlePower;
+  return energyUsed +
+         draw * std::chrono::duration<double>(now() - energyAt).count();
+}
+
+int Scheduler::subscribe(EventFilter filter, std::size_t batchSize,
+                         EventBus::Consumer consume,
+                         std::chrono::milliseconds maxDelay) {
+  return bus.subscribe(std::move(filter), batchSize, std::move(consume),
+                       maxDelay);
+}
+
+void Scheduler::unsubscribe(int id) { bus.unsubscribe(id); }
+
+std::optional<std::uint64_t> Scheduler::droppedEvents(int id) {
+  return bus.dropped(id);
+}
+
+bool Scheduler::perfReport([[maybe_unused]] std::ostream &out) {
+#ifdef EDFSIM_PERF
+  perf.report(out);
+  return true;
+#else
+  return false;
+#endif
+}
+
+std::optional<BlockingStats> Scheduler::blocking(int id) {
+  auto it = tasks.find(id);
+  if (it == tasks.end()) {
+    return std::nullopt;
+  }
+  const Task &t = it->second;
+  auto blocked = t.blockedFor;
+  if (t.blockedSince) {
+    blocked += now() - *t.blockedSince;
+  }
+  return BlockingStats{blocked, t.inversions};
+}
+
+void Scheduler::bindWorkload(int id, Workload body) {
+  {
+    std::lock_guard lk(interfaceMTX);
+    incomingWorkloads.emplace_back(id, std::move(body));
+  }
+  wake();
+}
+
+void Scheduler::pinWorkers(int cpu) {
+  std::lock_guard lk(interfaceMTX);
+  workerCPU = cpu;
+}
+
+void Scheduler::bindCoroutine(int id, CoroutineBody body) {
+  {
+    std::lock_guard lk(interfaceMTX);
+    incomingCoroutines.emplace_back(id, std::move(body));
   }
-  CV.notify_one();
+  wake();
 }
@@ -1,20 +1,88 @@
 // scheduler.hpp - declarations for Task and Scheduler
 #pragma once
 
+#include "corotask.hpp"
+#include "dvfs.hpp"
+#include "eventbus.hpp"
+#include "exectime.hpp"
+#include "executor.hpp"
+#include "metrics.hpp"
+#include "perfcounters.hpp"
 #include "process.hpp"
+#include "resource.hpp"
+#include "server.hpp"
+#include "trace.hpp"
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <filesystem>
 #include <functional>
+#include <future>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <ostream>
 #include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 enum class TaskStatus { uninitialized = 0, waiting, running, completed };
 
-enum class Interrupt { taskInit = 0, taskComplete, taskRestart, taskEdited };
+enum class Interrupt {
+  taskInit = 0,
+  taskComplete,
+  taskRestart,
+  // The job in progress reached its deadline before the next release.
+  deadlineMissed,
+  taskEdited,
+  preemptionPoint,
+  budgetExhausted,
+  sectionBoundary
+};
+
+enum class PreemptionMode { full = 0, nonPreemptive, deferred, fixedPoints };
+
+// How and at what price a runner can be preempted. Every dispatch costs
+// contextSwitch and resuming a preempted job also costs cacheRefill, both
+// charged as extra execution time of the job. For deferred, quantum is how
+// long a pending preemption may be postponed; for fixedPoints it is the
+// spacing of the preemption points in the job's execution.
+struct PreemptionModel {
+  PreemptionMode mode = PreemptionMode::full;
+  std::chrono::milliseconds quantum{0};
+  std::chrono::milliseconds contextSwitch{0};
+  std::chrono::milliseconds cacheRefill{0};
+};
+
+// What happens to the time a job does not use when it finishes under its
+// duration. none runs every job for its full duration, the worst-case
+// schedule. reclaim lets the next job start as soon as the work is done.
+// donate also enforces durations as budgets, CASH style: the unused budget
+// of an early job is kept as spare capacity until its deadline, and a job
+// that overruns its own budget first draws on spare capacity with a deadline
+// no later than its own, then falls back to running only when nothing else
+// is ready.
+enum class SlackPolicy { none = 0, reclaim, donate };
+
+// Time the jobs of a task spent ready while a lower priority job ran, and
+// how many separate times that happened.
+struct BlockingStats {
+  std::chrono::steady_clock::duration blocked;
+  std::uint64_t inversions;
+};
+
+struct SpareCapacity {
+  std::chrono::steady_clock::time_point deadline;
+  std::chrono::milliseconds amount;
+  bool operator==(const SpareCapacity &) const = default;
+};
 
 class Task {
   int id;
@@ -22,42 +90,335 @@ class Task {
   Interrupt onWake = Interrupt::taskInit;
   std::chrono::milliseconds period;
   std::chrono::milliseconds duration;
-  std::chrono::milliseconds runTime{0};
+  // Relative deadline as given, 0 for the period; see relativeDeadline().
+  std::chrono::milliseconds deadlineParam;
+  std::chrono::milliseconds jitter;
+  // Work done so far, in time at full speed.
+  std::chrono::steady_clock::duration runTime{0};
+  std::chrono::milliseconds overhead{0};
+  ExecutionTime execTime;
+  std::chrono::milliseconds demand;
+  std::chrono::milliseconds granted{0};
+  bool background = false;
+  // Set for a server: duration is its budget and period its replenishment
+  // period, and it runs queued aperiodic jobs instead of periodic ones.
+  std::optional<ServerState> server;
+  // Critical sections of every job, the next one to enter or leave, and
+  // whether the job is inside it.
+  std::vector<CriticalSection> sections;
+  std::size_t section = 0;
+  bool holding = false;
+  bool dispatched = false;
+  // The task whose lock or ceiling keeps this job from running.
+  std::optional<int> blockedOn;
+  std::optional<std::chrono::steady_clock::time_point> blockedSince;
+  std::chrono::steady_clock::duration blockedFor{};
+  std::uint64_t inversions = 0;
+  bool preempted = false;
+  bool atPoint = false;
+  std::uint64_t job = 0;
+  std::optional<std::pair<std::chrono::milliseconds, std::chrono::milliseconds>>
+      nextParams;
   std::chrono::steady_clock::time_point nextInterrupt;
   std::chrono::steady_clock::time_point deadline;
+  // Arrival of the job in progress.
   std::chrono::steady_clock::time_point refPoint;
+  // Arrival of the next job, and when it is released after its jitter.
+  std::chrono::steady_clock::time_point arrival;
+  std::chrono::steady_clock::time_point release;
 
 public:
-  Task(long period, long duration,
-       std::chrono::steady_clock::time_point nextInterrupt, int id);
+  Task(const TaskParams &params,
+       std::chrono::steady_clock::time_point arrival, int id);
   void run(std::chrono::steady_clock::duration duration);
+  std::chrono::milliseconds relativeDeadline() const {
+    return deadlineParam > deadlineParam.zero()
+               ? std::min(deadlineParam, period)
+               : period;
+  }
   friend class Scheduler;
 };
 
+// One instant of a compiled schedule: the events to replay at
+// tableBase + offset and the runner they leave behind.
+struct DispatchEntry {
+  std::chrono::steady_clock::duration offset;
+  std::vector<Event> events;
+  std::optional<int> runner;
+  std::uint32_t queueDepth = 0;
+};
+
+// The part of a scheduler that decides its future: enough to fork a copy
+// and fast-forward it in virtual time.
+struct ScheduleState {
+  std::map<int, Task> tasks;
+  std::optional<int> runTaskIndex;
+  std::chrono::steady_clock::time_point latestCP;
+  std::vector<SpareCapacity> spare;
+  double speed = 1;
+};
+
+// The outcome of simulating two hyperperiods from the state at start:
+// entries repeat every hyperperiod from settled, the state one hyperperiod
+// after start, with offsets counted from start. It is empty when the
+// schedule did not repeat or the table outgrew its cap.
+struct CompiledTable {
+  std::uint64_t generation = 0;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::duration hyperperiod{};
+  std::vector<DispatchEntry> entries;
+  bool capped = false;
+  ScheduleState settled;
+};
+
+// Everything needed to continue a scheduler elsewhere: its state, policy
+// and configuration at one instant. Snapshots are immutable and shared, so
+// any number of forks can start from one without copying it up front.
+struct Snapshot {
+  ScheduleState state;
+  SchedulingAlgo algo;
+  PreemptionModel preemption;
+  std::chrono::microseconds coalesceWindow;
+  SlackPolicy slackPolicy;
+  LockProtocol protocol;
+  DvfsPolicy dvfs;
+  PowerModel power;
+  int nextId;
+  std::chrono::steady_clock::time_point at;
+  std::mt19937_64 rng;
+};
+
+struct TaskEdit {
+  int id;
+  long period;
+  long duration;
+  EditMode mode = EditMode::nextRelease;
+};
+
+// A batch of interface changes staged together. Scheduler::commit hands the
+// whole batch to the scheduler thread under one lock and with one wakeup, so
+// no scheduling decision is ever taken on a half-applied batch.
+struct Transaction {
+  std::vector<TaskParams> adds;
+  std::vector<int> removes;
+  std::vector<TaskEdit> edits;
+  std::optional<SchedulingAlgo> algo;
+  // Instant the release delays of adds count from; committing one batch to
+  // several schedulers with the same instant gives them identical releases.
+  std::optional<std::chrono::steady_clock::time_point> at;
+
+  Transaction &add(TaskParams params) {
+    adds.push_back(params);
+    return *this;
+  }
+  Transaction &add(std::span<const TaskParams> params) {
+    adds.insert(adds.end(), params.begin(), params.end());
+    return *this;
+  }
+  Transaction &remove(int id) {
+    removes.push_back(id);
+    return *this;
+  }
+  Transaction &remove(std::span<const int> ids) {
+    removes.insert(removes.end(), ids.begin(), ids.end());
+    return *this;
+  }
+  Transaction &edit(int id, long period, long duration,
+                    EditMode mode = EditMode::nextRelease) {
+    edits.push_back({id, period, duration, mode});
+    return *this;
+  }
+  Transaction &assignAlgo(SchedulingAlgo newAlgo) {
+    algo = newAlgo;
+    return *this;
+  }
+  bool empty() const {
+    return adds.empty() && removes.empty() && edits.empty() && !algo;
+  }
+};
+
+struct CoroutineTask {
+  CoroutineBody body;
+  CoroJob job;
+  std::uint64_t jobId = 0;
+  std::chrono::steady_clock::duration executed{};
+};
+
+class SchedulerHost;
+
 class Scheduler {
   std::map<int, Task> tasks;
   std::mutex interfaceMTX;
   std::condition_variable CV;
   std::vector<int> tasksToRemove;
-  std::vector<std::tuple<long, long, long, int>> incoming;
+  std::vector<TaskEdit> edits;
+  std::vector<std::promise<std::shared_ptr<const Snapshot>>> snapshotRequests;
+  std::vector<std::promise<std::chrono::steady_clock::time_point>> fences;
+  std::vector<std::tuple<TaskParams, std::chrono::steady_clock::time_point, int>>
+      incoming;
   std::chrono::steady_clock timer;
   std::chrono::steady_clock::time_point startTime;
   std::chrono::steady_clock::time_point latestCP;
   std::optional<int> runTaskIndex;
   std::optional<std::tuple<int, Interrupt>> firedInterrupt;
+  std::vector<std::pair<int, Workload>> incomingWorkloads;
+  std::vector<std::pair<int, CoroutineBody>> incomingCoroutines;
+  std::vector<std::pair<int, ExecutionTime>> incomingExecTimes;
+  std::vector<std::pair<int, ServerKind>> incomingServers;
+  std::vector<std::pair<int, std::vector<CriticalSection>>> incomingSections;
+  std::vector<std::tuple<int, std::chrono::steady_clock::time_point,
+                         std::chrono::milliseconds>>
+      incomingJobs;
+  // Response times of the aperiodic jobs of every server.
+  ResponseHistogram aperiodic;
+  std::vector<std::tuple<int, std::uint64_t, std::chrono::steady_clock::duration>>
+      finishedJobs;
+  int workerCPU = 0;
+  std::optional<std::chrono::steady_clock::time_point> virtualNow;
+  // The only source of randomness a scheduler may use, so that a seeded
+  // virtual-time run is reproducible.
+  std::mt19937_64 rng;
+  std::chrono::microseconds coalesceWindow{1000};
+  std::optional<std::chrono::microseconds> coalesceBuf;
+  PreemptionModel preemption;
+  std::optional<PreemptionModel> preemptionBuf;
+  SlackPolicy slackPolicy = SlackPolicy::reclaim;
+  std::optional<SlackPolicy> slackPolicyBuf;
+  // Spare capacity in deadline order, for SlackPolicy::donate.
+  std::vector<SpareCapacity> spare;
+  LockProtocol protocol = LockProtocol::none;
+  std::optional<LockProtocol> protocolBuf;
+  DvfsPolicy dvfs = DvfsPolicy::off;
+  PowerModel power;
+  std::optional<std::pair<DvfsPolicy, PowerModel>> dvfsBuf;
+  // Current processor speed, a fraction of the full clock.
+  double speed = 1;
+  std::optional<double> staticSpeed;
+  // Energy used up to energyAt, in seconds at full-speed power.
+  double energyUsed = 0;
+  std::chrono::steady_clock::time_point energyAt;
+#ifdef EDFSIM_PERF
+  PerfProfile perf;
+#endif
   int nextId = 0;
 
   SchedulingAlgo algo = SchedulingAlgo::EDF;
   std::optional<SchedulingAlgo> algoBuf = std::nullopt;
+  std::unique_ptr<MetricsSegment> metrics;
+  std::unique_ptr<MetricsSegment> metricsBuf;
+  std::unique_ptr<TraceWriter> trace;
+  std::unique_ptr<TraceWriter> traceBuf;
+  EventBus bus;
+
+  bool tableMode = false;
+  std::optional<bool> tableModeBuf;
+  std::vector<DispatchEntry> table;
+  std::size_t tableIndex = 0;
+  std::size_t loopStart = 0;
+  std::chrono::steady_clock::time_point tableBase;
+  std::chrono::steady_clock::duration hyperperiod{};
+  std::chrono::steady_clock::time_point nextCompile;
+  // Compilation runs on its own thread from a copy of the state. Its result
+  // is staged in compiledBuf and dropped if the task set or configuration
+  // changed since, which bumps compileGeneration. Failed compiles back off
+  // by doubling hyperperiods until maxCompileAttempts.
+  bool compiling = false;
+  std::uint64_t compileGeneration = 0;
+  int compileFailures = 0;
+  std::optional<CompiledTable> compiledBuf;
+  std::optional<CompiledTable> pendingTable;
+  // Latest nominal instant handled by handleDue, where a compiled table
+  // can take over.
+  std::chrono::steady_clock::time_point lastDue;
+  std::jthread compiler;
+  std::chrono::steady_clock::time_point lastEmitted;
+  std::chrono::steady_clock::time_point anchorTime;
+  ScheduleState anchor;
+  ScheduleState loopAnchor;
 
-  void addTask(std::tuple<long, long, long, int> &taskParam);
+  std::unique_ptr<Executor> executor;
+  std::map<int, CoroutineTask> coroutines;
+  SliceControl slice;
+  std::atomic<SchedulerHost *> host{nullptr};
+  std::uint64_t hostSlot = 0;
+  friend class SchedulerHost;
+
+  std::chrono::steady_clock::time_point now();
+  void emit(Event e);
+  std::uint32_t queueDepth();
+  void updateMetrics(std::uint32_t depth);
+  bool pendingInterface();
+  bool pendingInterfaceLocked();
+  void wake();
+  void addTask(const std::tuple<TaskParams,
+                                std::chrono::steady_clock::time_point, int>
+                   &taskParam);
   void deleteTask(int id);
+  void applyEdit(const TaskEdit &edit);
+  bool onWorker(int id);
+  bool executes(int id);
+  void releaseJob(Task &t);
+  void drawDemand(Task &t);
+  void scheduleRelease(Task &t, std::chrono::steady_clock::time_point arrival);
+  void armDeadline(Task &t);
+  std::chrono::milliseconds work(const Task &t) const;
+  void donateSlack(const Task &t);
+  void chargeSpare(const Task &t);
+  void claimSlack(Task &t);
+  void chargeServer(Task &t);
+  void enqueueJob(Task &t, AperiodicJob job);
+  void settleServer(Task &t);
+  void armServer(Task &t);
+  void serverInterrupt(Task &t, Interrupt interrupt);
+  bool outranks(const Task &a, const Task &b) const;
+  long ceiling(const std::string &resource) const;
+  std::optional<int> lockBlocker(const Task &t) const;
+  void lock(Task &t);
+  void unlock(Task &t);
+  void trackInversions();
+  std::chrono::steady_clock::duration
+  scaled(std::chrono::steady_clock::duration span) const;
+  std::chrono::steady_clock::duration
+  wallTime(std::chrono::steady_clock::duration work) const;
+  std::chrono::steady_clock::duration remaining(const Task &t);
+  double staticLevel();
+  double conservingSpeed();
+  double lookAheadSpeed();
+  double pacedSpeed();
+  void adjustSpeed();
+  void accountEnergy();
+  void driveCoroutine(std::chrono::steady_clock::time_point until);
+  void finishJob(int id, std::uint64_t job,
+                 std::chrono::steady_clock::duration executed);
   void handleInterface();
 
   std::tuple<std::chrono::steady_clock::time_point, int, Interrupt>
   nextInterrupt();
   void handleInterrupt(std::tuple<int, Interrupt> firedInterrupt);
   void selectRunner();
+  void armRunner(Task &t);
+  void armPreemptionPoint(Task &runner);
+  void handleDue();
+  void step();
+  // Stops early once afterStep returns false.
+  void runUntil(std::chrono::steady_clock::time_point horizon,
+                std::function<bool()> afterStep = {});
+
+  void copyConfig(const Scheduler &other);
+  std::optional<std::chrono::milliseconds> computeHyperperiod();
+  ScheduleState captureState();
+  void restoreState(ScheduleState state,
+                    std::chrono::steady_clock::duration shift = {});
+  bool matchesState(const ScheduleState &other,
+                    std::chrono::steady_clock::duration shift);
+  void compileTable();
+  static CompiledTable simulateTable(Scheduler &shadow,
+                                     std::vector<Event> &recorded,
+                                     CompiledTable out, std::stop_token stop);
+  void finishCompile(CompiledTable result);
+  bool installTable();
+  std::optional<std::chrono::steady_clock::time_point> walkTable();
+  void leaveTable();
 
 public:
   std::function<void(Event)> eventInterface;
@@ -69,9 +430,77 @@ public:
   Scheduler(Scheduler &&other) = delete;
   Scheduler &operator=(const Scheduler &&other) = delete;
   ~Scheduler();
-  void initTasks(std::vector<std::tuple<long, long, long>> paramVector);
+  void initTasks(std::span<const TaskParams> paramVector,
+                 std::optional<std::chrono::steady_clock::time_point> at = {});
   void removeTasks(std::vector<int> tasksId);
+  void editTask(int id, long period, long duration,
+                EditMode mode = EditMode::nextRelease);
   void assignAlgo(SchedulingAlgo newAlgo);
+  int commit(const Transaction &tx);
+  void publishMetrics(std::string name);
+  void traceTo(const std::filesystem::path &path);
+  void useDispatchTable(bool enable);
+  void setCoalesceWindow(std::chrono::microseconds window);
+  void setPreemptionModel(PreemptionModel model);
+  // Takes effect from the task's next release on.
+  void setExecutionTime(int id, ExecutionTime model);
+  void setSlackPolicy(SlackPolicy policy);
+  // Adds a server with the given budget and period in ms and returns its
+  // id, which submit() takes. Servers share the id space of tasks and are
+  // removed and edited like them.
+  int addServer(ServerKind kind, long budget, long period,
+                std::optional<std::chrono::steady_clock::time_point> at = {});
+  // Queues aperiodic jobs needing work each, arriving now. Cheap enough for
+  // bursts: the scheduler is only woken for the first job of a batch it has
+  // not picked up yet.
+  void submit(int server, std::chrono::milliseconds work);
+  void submit(int server, std::span<const std::chrono::milliseconds> work);
+  // Like snapshot(), only for the thread driving the scheduler.
+  std::optional<ResponseHistogram> serverResponses(int server);
+  // Replaces the critical sections of a task's jobs; the job in progress
+  // skips those it has already passed. Tasks with a bound workload or
+  // coroutine ignore them.
+  void setCriticalSections(int id, std::vector<CriticalSection> sections);
+  void setLockProtocol(LockProtocol protocol);
+  // Like snapshot(), only for the thread driving the scheduler.
+  std::optional<BlockingStats> blocking(int id);
+  void setDvfs(DvfsPolicy policy, PowerModel model = {});
+  // Adds a consumer of the event stream beside eventInterface, running on
+  // its own thread; see EventBus. Callable from any thread.
+  int subscribe(EventFilter filter, std::size_t batchSize,
+                EventBus::Consumer consume,
+                std::chrono::milliseconds maxDelay =
+                    std::chrono::milliseconds(100));
+  void unsubscribe(int id);
+  // Events a subscriber missed by falling too far behind.
+  std::optional<std::uint64_t> droppedEvents(int id);
+  // Energy used since the scheduler started, in seconds of full-speed
+  // power; for the thread driving the scheduler.
+  double energy();
+  // Prints the hardware counters of loop, selectRunner, nextInterrupt and
+  // handleInterface by phase and task count. Returns false, printing
+  // nothing, unless built with EDFSIM_PERF. Callable from any thread.
+  bool perfReport(std::ostream &out);
+  void bindWorkload(int id, Workload body);
+  void bindCoroutine(int id, CoroutineBody body);
+  void pinWorkers(int cpu);
   void stop();
+  std::chrono::steady_clock::time_point poll();
   void loop();
+  // Deterministic mode: time starts at a fixed epoch and only advances
+  // through runFor, on the caller's thread, instead of loop() or poll().
+  // Identical inputs and seed give a bit-identical event trace. Tasks with
+  // bound workloads or coroutines run on real time and are not reproducible.
+  void useVirtualTime(std::uint64_t seed = 0);
+  void runFor(std::chrono::steady_clock::duration span);
+  // snapshot() must be called from the thread driving the scheduler;
+  // requestSnapshot() may be called from anywhere and is answered by it.
+  // restore() puts a fresh scheduler in deterministic mode at the
+  // snapshot's instant. Bound workloads and coroutines are not carried over.
+  std::shared_ptr<const Snapshot> snapshot();
+  std::future<std::shared_ptr<const Snapshot>> requestSnapshot();
+  // Resolves with the wall-clock time at which the scheduler thread has
+  // applied everything staged before the call. Callable from any thread.
+  std::future<std::chrono::steady_clock::time_point> fence();
+  void restore(const Snapshot &snap);
 };
@@ -0,0 +1,82 @@
+#include "server.hpp"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <system_error>
+
+namespace {
+// Values below subBuckets get a bucket each; above, a power of two is split
+// into subBuckets equal parts.
+int bucketOf(std::uint64_t us, int subBuckets) {
+  if (us < static_cast<std::uint64_t>(subBuckets)) {
+    return static_cast<int>(us);
+  }
+  int shift = std::bit_width(us) - std::bit_width(
+                                       static_cast<unsigned>(subBuckets));
+  return (shift + 1) * subBuckets +
+         static_cast<int>((us >> shift) - subBuckets);
+}
+
+std::uint64_t upperBound(int bucket, int subBuckets) {
+  if (bucket < subBuckets) {
+    return bucket;
+  }
+  int shift = bucket / subBuckets - 1;
+  std::uint64_t base = subBuckets + bucket % subBuckets;
+  return ((base + 1) << shift) - 1;
+}
+} // namespace
+
+std::optional<ServerSpec> parseServer(std::string_view spec) {
+  auto first = spec.find(':');
+  auto second = spec.find(':', first + 1);
+  if (first == std::string_view::npos || second == std::string_view::npos) {
+    return std::nullopt;
+  }
+  std::string_view kind = spec.substr(0, first);
+  ServerSpec result{ServerKind::constantBandwidth, 0, 0};
+  const char *end = spec.data() + spec.size();
+  auto [budgetEnd, budgetEc] =
+      std::from_chars(spec.data() + first + 1, spec.data() + second,
+                      result.budget);
+  auto [periodEnd, periodEc] =
+      std::from_chars(spec.data() + second + 1, end, result.period);
+  if (budgetEc != std::errc{} || periodEc != std::errc{} ||
+      budgetEnd != spec.data() + second || periodEnd != end ||
+      result.budget <= 0 || result.period <= 0) {
+    return std::nullopt;
+  }
+  if (kind == "polling") {
+    result.kind = ServerKind::polling;
+  } else if (kind == "deferrable") {
+    result.kind = ServerKind::deferrable;
+  } else if (kind != "cbs") {
+    return std::nullopt;
+  }
+  return result;
+}
+
+void ResponseHistogram::add(std::chrono::steady_clock::duration response) {
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(response);
+  std::uint64_t value = std::max<std::int64_t>(us.count(), 0);
+  counts[std::min<int>(bucketOf(value, subBuckets), counts.size() - 1)]++;
+  total++;
+}
+
+std::chrono::microseconds ResponseHistogram::percentile(double q) const {
+  if (total == 0) {
+    return {};
+  }
+  auto rank = static_cast<std::uint64_t>(
+      std::ceil(std::clamp(q, 0.0, 1.0) * total));
+  rank = std::max<std::uint64_t>(rank, 1);
+  std::uint64_t seen = 0;
+  for (int b = 0; b < static_cast<int>(counts.size()); b++) {
+    seen += counts[b];
+    if (seen >= rank) {
+      return std::chrono::microseconds(upperBound(b, subBuckets));
+    }
+  }
+  return std::chrono::microseconds::max();
+}
@@ -0,0 +1,52 @@
+// server.hpp - bandwidth servers for aperiodic jobs
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string_view>
+
+// How a server hands out its budget. constantBandwidth (EDF) keeps a
+// deadline that moves a period ahead whenever the budget runs out, so the
+// server never uses more than budget/period of the processor. polling and
+// deferrable (RMS) get their budget back at every period boundary; a
+// polling server drops it as soon as it has nothing to do, a deferrable
+// server keeps it until the end of the period.
+enum class ServerKind { constantBandwidth = 0, polling, deferrable };
+
+struct AperiodicJob {
+  std::chrono::steady_clock::time_point arrival;
+  std::chrono::milliseconds work;
+};
+
+// Response times on a log-linear scale of microseconds: eight sub-buckets
+// per power of two, so a percentile is within 1/8 of the true value.
+class ResponseHistogram {
+  static constexpr int subBuckets = 8;
+  std::array<std::uint64_t, 64 * subBuckets> counts{};
+  std::uint64_t total = 0;
+
+public:
+  void add(std::chrono::steady_clock::duration response);
+  std::uint64_t count() const { return total; }
+  // Upper bound of the bucket holding the q-th quantile, q in [0, 1].
+  std::chrono::microseconds percentile(double q) const;
+};
+
+struct ServerSpec {
+  ServerKind kind;
+  long budget;
+  long period;
+};
+
+// Parses cbs:<budget>:<period>, polling:... or deferrable:..., in ms.
+std::optional<ServerSpec> parseServer(std::string_view spec);
+
+struct ServerState {
+  ServerKind kind;
+  std::deque<AperiodicJob> queue;
+  std::chrono::milliseconds budget{0};
+  ResponseHistogram responses;
+};
@@ -0,0 +1,260 @@
+#include "taskset.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace {
+constexpr std::size_t chunkSize = 1 << 16;
+
+enum class Row { task, skipped, malformed };
+
+bool isJson(const std::filesystem::path &path) {
+  return path.extension() == ".json";
+}
+
+const char *skipSpace(const char *p, const char *end) {
+  while (p != end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+    p++;
+  }
+  return p;
+}
+
+bool parseLong(const char *&p, const char *end, long &value) {
+  p = skipSpace(p, end);
+  auto [ptr, ec] = std::from_chars(p, end, value);
+  if (ec != std::errc{}) {
+    return false;
+  }
+  p = ptr;
+  return true;
+}
+
+bool validTask(const TaskParams &task) {
+  return task.period > 0 && task.duration > 0 && task.delay >= 0 &&
+         task.deadline >= 0 && task.jitter >= 0 && task.jitter < task.period;
+}
+
+// One CSV row without its line break. A non-numeric row is only accepted as
+// a header before the first task.
+Row parseCsvRow(const char *p, const char *end, bool allowHeader,
+                TaskParams &task) {
+  p = skipSpace(p, end);
+  if (p == end || *p == '#') {
+    return Row::skipped;
+  }
+  long values[5] = {0, 0, 0, 0, 0};
+  int n = 0;
+  while (true) {
+    if (!parseLong(p, end, values[n])) {
+      return allowHeader && n == 0 ? Row::skipped : Row::malformed;
+    }
+    n++;
+    p = skipSpace(p, end);
+    if (p == end) {
+      break;
+    }
+    if (*p != ',' || n == 5) {
+      return Row::malformed;
+    }
+    p++;
+  }
+  task = {values[0], values[1], values[2], values[3], values[4]};
+  if (n < 2 || !validTask(task)) {
+    return Row::malformed;
+  }
+  return Row::task;
+}
+
+// The members of one JSON object, from just after '{' to just before '}'.
+// Unknown numeric members are ignored.
+bool parseJsonObject(const char *p, const char *end, TaskParams &task) {
+  TaskParams parsed;
+  while (true) {
+    p = skipSpace(p, end);
+    if (p == end) {
+      break;
+    }
+    if (*p != '"') {
+      return false;
+    }
+    const char *key = ++p;
+    p = std::find(p, end, '"');
+    if (p == end) {
+      return false;
+    }
+    std::string_view name(key, p - key);
+    p = skipSpace(p + 1, end);
+    if (p == end || *p != ':') {
+      return false;
+    }
+    long value;
+    if (!parseLong(++p, end, value)) {
+      return false;
+    }
+    if (name == "period") {
+      parsed.period = value;
+    } else if (name == "duration") {
+      parsed.duration = value;
+    } else if (name == "delay") {
+      parsed.delay = value;
+    } else if (name == "deadline") {
+      parsed.deadline = value;
+    } else if (name == "jitter") {
+      parsed.jitter = value;
+    }
+    p = skipSpace(p, end);
+    if (p != end) {
+      if (*p != ',') {
+        return false;
+      }
+      p++;
+    }
+  }
+  if (!validTask(parsed)) {
+    return false;
+  }
+  task = parsed;
+  return true;
+}
+
+// The parsers consume every complete record in [p, end) and return where
+// the unfinished tail starts, or nullptr on a malformed record. With last
+// set there is no more input and the tail must be complete too.
+const char *parseCsv(const char *p, const char *end, bool last,
+                     std::vector<TaskParams> &taskSet) {
+  while (p != end) {
+    const char *lineEnd = std::find(p, end, '\n');
+    if (lineEnd == end && !last) {
+      break;
+    }
+    TaskParams task;
+    Row row = parseCsvRow(p, lineEnd, taskSet.empty(), task);
+    if (row == Row::malformed) {
+      return nullptr;
+    }
+    if (row == Row::task) {
+      taskSet.push_back(task);
+    }
+    p = lineEnd == end ? end : lineEnd + 1;
+  }
+  return p;
+}
+
+const char *parseJson(const char *p, const char *end, bool last,
+                      std::vector<TaskParams> &taskSet) {
+  while (true) {
+    const char *open = std::find(p, end, '{');
+    if (open == end) {
+      return end;
+    }
+    const char *close = std::find(open, end, '}');
+    if (close == end) {
+      return last ? nullptr : open;
+    }
+    TaskParams task;
+    if (!parseJsonObject(open + 1, close, task)) {
+      return nullptr;
+    }
+    taskSet.push_back(task);
+    p = close + 1;
+  }
+}
+
+void appendLong(std::string &out, long value) {
+  char digits[24];
+  auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+  out.append(digits, end);
+}
+} // namespace
+
+std::optional<std::vector<TaskParams>>
+loadTaskSet(const std::filesystem::path &path) {
+  std::ifstream in(path, std::ios::in | std::ios::binary);
+  if (!in.is_open()) {
+    return std::nullopt;
+  }
+  bool json = isJson(path);
+  std::vector<TaskParams> taskSet;
+  std::error_code ec;
+  auto size = std::filesystem::file_size(path, ec);
+  if (!ec) {
+    taskSet.reserve(size / 16);
+  }
+
+  std::vector<char> buf(chunkSize);
+  std::size_t carry = 0;
+  while (true) {
+    if (carry == buf.size()) {
+      buf.resize(buf.size() * 2);
+    }
+    in.read(buf.data() + carry, buf.size() - carry);
+    if (in.bad()) {
+      return std::nullopt;
+    }
+    bool last = !in;
+    const char *begin = buf.data();
+    const char *end = begin + carry + in.gcount();
+    const char *rest = json ? parseJson(begin, end, last, taskSet)
+                            : parseCsv(begin, end, last, taskSet);
+    if (!rest) {
+      return std::nullopt;
+    }
+    if (last) {
+      return taskSet;
+    }
+    carry = end - rest;
+    std::memmove(buf.data(), rest, carry);
+  }
+}
+
+bool saveTaskSet(const std::filesystem::path &path,
+                 std::span<const TaskParams> taskSet) {
+  std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) {
+    return false;
+  }
+  bool json = isJson(path);
+  std::string buf;
+  buf.reserve(chunkSize + 128);
+  buf += json ? "[\n" : "period,duration,delay,deadline,jitter\n";
+  for (std::size_t i = 0; i < taskSet.size(); i++) {
+    const auto &[period, duration, delay, deadline, jitter] = taskSet[i];
+    if (json) {
+      buf += "  {\"period\": ";
+      appendLong(buf, period);
+      buf += ", \"duration\": ";
+      appendLong(buf, duration);
+      buf += ", \"delay\": ";
+      appendLong(buf, delay);
+      buf += ", \"deadline\": ";
+      appendLong(buf, deadline);
+      buf += ", \"jitter\": ";
+      appendLong(buf, jitter);
+      buf += i + 1 < taskSet.size() ? "},\n" : "}\n";
+    } else {
+      appendLong(buf, period);
+      buf += ',';
+      appendLong(buf, duration);
+      buf += ',';
+      appendLong(buf, delay);
+      buf += ',';
+      appendLong(buf, deadline);
+      buf += ',';
+      appendLong(buf, jitter);
+      buf += '\n';
+    }
+    if (buf.size() >= chunkSize) {
+      out.write(buf.data(), buf.size());
+      buf.clear();
+    }
+  }
+  if (json) {
+    buf += "]\n";
+  }
+  out.write(buf.data(), buf.size());
+  return static_cast<bool>(out);
+}
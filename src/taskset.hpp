@@ -0,0 +1,23 @@
+// taskset.hpp - streaming CSV/JSON task-set import and export
+#pragma once
+
+#include "process.hpp"
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+// Two formats are understood, picked by the file extension:
+//   .json  [{"period": 5000, "duration": 1000, "delay": 0}, ...], with
+//          optional "deadline" and "jitter" members
+//   other  one "period,duration[,delay[,deadline[,jitter]]]" row per line;
+//          blank lines, lines starting with '#' and a non-numeric header
+//          row are skipped.
+// The file is read in fixed-size chunks and parsed in place, so memory use
+// is the result vector plus one chunk. Returns nullopt if the file cannot be
+// read or any record is malformed.
+std::optional<std::vector<TaskParams>>
+loadTaskSet(const std::filesystem::path &path);
+
+bool saveTaskSet(const std::filesystem::path &path,
+                 std::span<const TaskParams> taskSet);
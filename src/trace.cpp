@@ -0,0 +1,209 @@
+#include "trace.hpp"
+#include "process.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+namespace {
+constexpr int taskPid = 1;
+constexpr int corePid = 2;
+constexpr int coreTid = 0;
+constexpr int blockedPid = 3;
+
+std::string taskName(int id) { return "Task " + std::to_string(id); }
+} // namespace
+
+TraceWriter::TraceWriter(const std::filesystem::path &path,
+                         std::chrono::steady_clock::time_point origin)
+    : out(path, std::ios::out | std::ios::trunc), origin(origin) {
+  if (!out.is_open()) {
+    return;
+  }
+  out << "[\n";
+  nameTrack(taskPid, -1, "Tasks");
+  nameTrack(corePid, -1, "Cores");
+  nameTrack(corePid, coreTid, "CPU 0");
+  nameTrack(blockedPid, -1, "Blocked");
+  writerT = std::jthread([this]() {
+    while (true) {
+      {
+        std::unique_lock lk(bufferMTX);
+        CV.wait_for(lk, std::chrono::milliseconds(250), [this]() {
+          return pending.size() >= flushThreshold || stopping;
+        });
+        std::swap(pending, draining);
+        if (stopping && draining.empty()) {
+          break;
+        }
+      }
+      drain();
+    }
+  });
+}
+
+TraceWriter::~TraceWriter() {
+  if (!out.is_open()) {
+    return;
+  }
+  {
+    std::lock_guard lk(bufferMTX);
+    stopping = true;
+  }
+  CV.notify_one();
+  writerT.join();
+
+  for (int id : openSlices) {
+    slice('E', taskPid, id, taskName(id), lastTs);
+  }
+  if (coreOwner) {
+    slice('E', corePid, coreTid, taskName(*coreOwner), lastTs);
+  }
+  for (int id : openBlocked) {
+    slice('E', blockedPid, id, "blocked", lastTs);
+  }
+  out << "\n]\n";
+}
+
+void TraceWriter::push(Event e) {
+  bool flush;
+  {
+    std::lock_guard lk(bufferMTX);
+    pending.push_back(e);
+    flush = pending.size() >= flushThreshold;
+  }
+  if (flush) {
+    CV.notify_one();
+  }
+}
+
+long long TraceWriter::micros(std::chrono::steady_clock::time_point t) const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(t - origin)
+      .count();
+}
+
+void TraceWriter::record(const char *json) {
+  if (!first) {
+    out << ",\n";
+  }
+  first = false;
+  out << json;
+}
+
+void TraceWriter::nameTrack(int pid, int tid, const std::string &name) {
+  char buf[160];
+  if (tid < 0) {
+    std::snprintf(buf, sizeof(buf),
+                  R"({"name":"process_name","ph":"M","pid":%d,)"
+                  R"("args":{"name":"%s"}})",
+                  pid, name.c_str());
+  } else {
+    std::snprintf(buf, sizeof(buf),
+                  R"({"name":"thread_name","ph":"M","pid":%d,"tid":%d,)"
+                  R"("args":{"name":"%s"}})",
+                  pid, tid, name.c_str());
+  }
+  record(buf);
+}
+
+void TraceWriter::slice(char phase, int pid, int tid, const std::string &name,
+                        long long ts) {
+  char buf[160];
+  std::snprintf(buf, sizeof(buf),
+                R"({"name":"%s","ph":"%c","pid":%d,"tid":%d,"ts":%lld})",
+                name.c_str(), phase, pid, tid, ts);
+  record(buf);
+}
+
+void TraceWriter::instant(int tid, const char *name, long long ts) {
+  char buf[160];
+  std::snprintf(buf, sizeof(buf),
+                R"({"name":"%s","ph":"i","s":"t","pid":%d,"tid":%d,"ts":%lld})",
+                name, taskPid, tid, ts);
+  record(buf);
+}
+
+void TraceWriter::write(const Event &e) {
+  long long ts = micros(e.time);
+  lastTs = std::max(lastTs, ts);
+  if (namedTasks.insert(e.id).second) {
+    nameTrack(taskPid, e.id, taskName(e.id));
+    nameTrack(blockedPid, e.id, taskName(e.id));
+  }
+
+  auto closeRun = [&]() {
+    if (openSlices.erase(e.id)) {
+      slice('E', taskPid, e.id, taskName(e.id), ts);
+    }
+    if (coreOwner == e.id) {
+      slice('E', corePid, coreTid, taskName(e.id), ts);
+      coreOwner.reset();
+    }
+  };
+
+  switch (e.type) {
+  case EventType::start:
+    closeRun();
+    if (coreOwner) {
+      slice('E', corePid, coreTid, taskName(*coreOwner), ts);
+    }
+    slice('B', taskPid, e.id, taskName(e.id), ts);
+    slice('B', corePid, coreTid, taskName(e.id), ts);
+    openSlices.insert(e.id);
+    coreOwner = e.id;
+    break;
+  case EventType::preempt:
+    closeRun();
+    instant(e.id, "preempt", ts);
+    break;
+  case EventType::complete:
+    closeRun();
+    instant(e.id, "complete", ts);
+    break;
+  case EventType::missed:
+    closeRun();
+    instant(e.id, "missed", ts);
+    break;
+  case EventType::initialize:
+  case EventType::restart:
+    instant(e.id, "release", ts);
+    break;
+  // Blocked intervals get their own tracks: they close in the same instant
+  // the job's run opens.
+  case EventType::block:
+    slice('B', blockedPid, e.id, "blocked", ts);
+    openBlocked.insert(e.id);
+    break;
+  case EventType::unblock:
+    if (openBlocked.erase(e.id)) {
+      slice('E', blockedPid, e.id, "blocked", ts);
+    }
+    break;
+  }
+}
+
+void TraceWriter::drain() {
+  for (const Event &e : draining) {
+    write(e);
+  }
+  draining.clear();
+  out.flush();
+}
+
+void TraceHash::mix(std::uint64_t value) {
+  for (int i = 0; i < 8; i++) {
+    hash ^= (value >> (8 * i)) & 0xff;
+    hash *= 0x100000001b3ULL;
+  }
+}
+
+void TraceHash::push(const Event &e) {
+  mix(static_cast<std::uint64_t>(e.type));
+  mix(static_cast<std::uint64_t>(e.id));
+  mix(static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          e.time.time_since_epoch())
+          .count()));
+  count++;
+}
@@ -0,0 +1,66 @@
+// trace.hpp - streaming Chrome Trace Event / Perfetto JSON exporter
+#pragma once
+
+#include "process.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <thread>
+#include <vector>
+
+// FNV-1a over the type, task and timestamp of every event: a compact
+// fingerprint of a schedule for regression checks. Bytes are mixed in a
+// fixed order so the value does not depend on the host's endianness.
+class TraceHash {
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  std::uint64_t count = 0;
+  void mix(std::uint64_t value);
+
+public:
+  void push(const Event &e);
+  std::uint64_t value() const { return hash; }
+  std::uint64_t events() const { return count; }
+};
+
+class TraceWriter {
+  std::ofstream out;
+  std::chrono::steady_clock::time_point origin;
+  std::mutex bufferMTX;
+  std::condition_variable CV;
+  std::vector<Event> pending;
+  std::vector<Event> draining;
+  std::set<int> namedTasks;
+  std::set<int> openSlices;
+  std::set<int> openBlocked;
+  std::optional<int> coreOwner;
+  // Timestamp of the latest event written, where open slices end. Events
+  // may be on a virtual clock, so the wall clock says nothing about it.
+  long long lastTs = 0;
+  bool first = true;
+  bool stopping = false;
+  std::size_t flushThreshold = 1 << 12;
+  std::jthread writerT;
+
+  long long micros(std::chrono::steady_clock::time_point t) const;
+  void record(const char *json);
+  void nameTrack(int pid, int tid, const std::string &name);
+  void slice(char phase, int pid, int tid, const std::string &name,
+             long long ts);
+  void instant(int tid, const char *name, long long ts);
+  void write(const Event &e);
+  void drain();
+
+public:
+  TraceWriter(const std::filesystem::path &path,
+              std::chrono::steady_clock::time_point origin);
+  TraceWriter(const TraceWriter &) = delete;
+  TraceWriter &operator=(const TraceWriter &) = delete;
+  ~TraceWriter();
+  bool ok() const { return out.is_open(); }
+  void push(Event e);
+};
@@ -1,4 +1,5 @@
 #include "view.hpp"
+#include "frameprofiler.hpp"
 #include "process.hpp"
 #include <array>
 #include <filesystem>
@@ -54,7 +55,8 @@ void TraySection::updateWait(int id, bool wait) {
 }
 
 void TraySection::draw(int activeProc) {
-  DrawRectangleRounded(mainRec, 0.25, 0, {30, 34, 42, 255});
+  auto scope = frameProfiler().measure(FrameStage::trayDraw);
+  counted(DrawRectangleRounded, mainRec, 0.25, 0, {30, 34, 42, 255});
   for (const auto &[id, p] : *procPool) {
     const auto &[waiting, color] = p;
 
@@ -62,23 +64,24 @@ void TraySection::draw(int activeProc) {
     int index = std::distance(procPool->begin(), mapIT);
 
     if (auto cell = cellParameters(index); waiting) {
-      DrawRectangleRounded(cell, 0.25, 0, color);
+      counted(DrawRectangleRounded, cell, 0.25, 0, color);
     } else {
       cell.x += 2;
       cell.y += 2;
       cell.height -= 4;
       cell.width -= 4;
 
-      DrawRectangleRoundedLinesEx(cell, 0.25, 0, 2, color);
+      counted(DrawRectangleRoundedLinesEx, cell, 0.25, 0, 2, color);
     }
   }
   if (procPool->contains(activeProc)) {
-    DrawRectangleRounded(runingRec, 0.25, 0, procPool->at(activeProc).second);
-    DrawText(std::to_string(activeProc).c_str(),
-             runingRec.x + runingRec.width / 4.f, runingRec.y, runingRec.height,
-             WHITE);
+    counted(DrawRectangleRounded, runingRec, 0.25, 0,
+            procPool->at(activeProc).second);
+    counted(DrawText, std::to_string(activeProc).c_str(),
+            runingRec.x + runingRec.width / 4.f, runingRec.y, runingRec.height,
+            WHITE);
   } else {
-    DrawRectangleRounded(runingRec, 0.25, 0, {30, 34, 42, 255});
+    counted(DrawRectangleRounded, runingRec, 0.25, 0, {30, 34, 42, 255});
   }
 }
 
@@ -98,12 +101,15 @@ TimeLine::TimeLine(
 
 void TimeLine::advanceState() {
   elements.clear();
+  blockedElements.clear();
   int elementNumber = this->procPool->size();
   if (elementNumber <= 0) {
     return;
   }
   std::vector<std::optional<std::pair<TLElement, std::list<Event>::iterator>>>
       elementBuffer(elementNumber);
+  std::vector<std::optional<std::pair<TLElement, std::list<Event>::iterator>>>
+      blockBuffer(elementNumber);
 
   for (auto it = events->begin(); it != events->end();) {
     if (!procPool->contains(it->id)) {
@@ -115,6 +121,33 @@ void TimeLine::advanceState() {
 
     const auto mapIT = procPool->find(it->id);
     int index = std::distance(procPool->begin(), mapIT);
+    // Blocked intervals pair up on their own, apart from runs
+    if (it->type == EventType::block) {
+      if (blockBuffer[index]) {
+        it = events->erase(it);
+      } else {
+        blockBuffer[index] = {
+            std::make_tuple(it->timeSince, std::nullopt, it->id), it};
+        it++;
+      }
+      continue;
+    } else if (it->type == EventType::unblock) {
+      if (!blockBuffer[index]) {
+        it = events->erase(it);
+        continue;
+      }
+      auto &[start, end, proc] = blockBuffer[index]->first;
+      end = it->timeSince;
+      if (start == timeLineDuration && it->timeSince >= timeLineDuration) {
+        events->erase(blockBuffer[index]->second);
+        it = events->erase(it);
+      } else {
+        blockedElements.push_back(blockBuffer[index]->first);
+        it++;
+      }
+      blockBuffer[index].reset();
+      continue;
+    }
     // Events responsiple for setting the wait state only
     if (it->type == EventType::initialize || it->type == EventType::restart) {
       it = events->erase(it);
@@ -170,6 +203,21 @@ void TimeLine::advanceState() {
       elements.push_back(buffered->first);
     }
   }
+  for (auto &buffered : blockBuffer) {
+    if (buffered.has_value()) {
+      auto &[start, end, proc] = buffered->first;
+      end = 0;
+      blockedElements.push_back(buffered->first);
+    }
+  }
+}
+
+void TimeLine::setArea(Rectangle area) {
+  x = area.x;
+  y = area.y;
+  width = area.width;
+  height = area.height;
+  mainRec = area;
 }
 
 std::pair<float, float> TimeLine::getPosWidth(float start, float end) {
@@ -199,6 +247,7 @@ std::pair<float, float> TimeLine::getImgCoor() {
 }
 
 void TimeLine::drawTimeLine() {
+  auto scope = frameProfiler().measure(FrameStage::drawTimeLine);
   for (const TLElement &element : elements) {
     auto [start, end, id] = element;
 
@@ -206,12 +255,28 @@ void TimeLine::drawTimeLine() {
     int index = std::distance(procPool->begin(), mapIT);
 
     auto [posX, width] = getPosWidth(start, end.value());
-    DrawRectangle(posX, getLaneY(index), width, getLaneHeight(),
-                  mapIT->second.second);
+    counted(DrawRectangle, posX, getLaneY(index), width, getLaneHeight(),
+            mapIT->second.second);
+  }
+  for (const TLElement &element : blockedElements) {
+    auto [start, end, id] = element;
+
+    const auto mapIT = procPool->find(id);
+    int index = std::distance(procPool->begin(), mapIT);
+
+    auto [posX, width] = getPosWidth(start, end.value());
+    Color color = mapIT->second.second;
+    color.a = 70;
+    counted(DrawRectangle, posX, getLaneY(index), width, getLaneHeight(),
+            color);
+    color.a = 255;
+    counted(DrawRectangleLines, posX, getLaneY(index), width, getLaneHeight(),
+            color);
   }
 }
 
 void TimeLine::drawLogs() {
+  auto scope = frameProfiler().measure(FrameStage::drawLogs);
   for (const auto &event : (*events)) {
     Texture sprite;
     Color color;
@@ -231,15 +296,15 @@ void TimeLine::drawLogs() {
     if (posX - 5 > this->x) {
       const auto &[imgY, imgHeight] = getImgCoor();
       float height = procPool->size() * getLaneHeight();
-      DrawRectangle(posX - width, getLaneY(0), width, height, color);
-      DrawTextureEx(sprite, {posX - width, imgY}, 0, imgHeight / sprite.height,
-                    WHITE);
+      counted(DrawRectangle, posX - width, getLaneY(0), width, height, color);
+      counted(DrawTextureEx, sprite, {posX - width, imgY}, 0,
+              imgHeight / sprite.height, WHITE);
     }
   }
 }
 
 void TimeLine::draw() {
-  DrawRectangleRounded(mainRec, 0.10, 0, {30, 34, 42, 255});
+  counted(DrawRectangleRounded, mainRec, 0.10, 0, {30, 34, 42, 255});
   drawTimeLine();
   drawLogs();
 }
@@ -251,9 +316,46 @@ View::View(float width, float height, std::filesystem::path pExcutable)
       execPath(pExcutable), tray(44, 83, 320, 110, procPool),
       timeline(44, 260, 713, 500, events, procPool, pExcutable) {}
 
+void View::count(PolicyStats &stats, const Event &e) {
+  switch (e.type) {
+  case EventType::initialize:
+  case EventType::restart:
+    stats.released++;
+    stats.releasedAt[e.id] = e.time;
+    break;
+  case EventType::complete:
+    stats.completed++;
+    stats.responseMs += std::chrono::duration<double, std::milli>(
+                            e.time - stats.releasedAt[e.id])
+                            .count();
+    break;
+  case EventType::preempt:
+    stats.preempted++;
+    break;
+  case EventType::missed:
+    stats.missed++;
+    break;
+  case EventType::block:
+    stats.inversions++;
+    stats.blockedAt[e.id] = e.time;
+    break;
+  case EventType::unblock:
+    if (auto it = stats.blockedAt.find(e.id); it != stats.blockedAt.end()) {
+      stats.blockedMs +=
+          std::chrono::duration<double, std::milli>(e.time - it->second)
+              .count();
+      stats.blockedAt.erase(it);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
 void View::eventInterface(Event e) {
   {
     std::lock_guard lk(eventMTX);
+    count(stats, e);
     if (e.type != EventType::initialize && e.type != EventType::restart) {
       events->emplace_back(e);
     }
@@ -269,9 +371,14 @@ void View::eventInterface(Event e) {
     std::lock_guard lk(APMTX);
     activeProc = -1;
   } break;
-  case EventType::missed:
-    tray.updateWait(e.id, true);
-    break;
+  // The job is dropped; a restart follows at its next release.
+  case EventType::missed: {
+    std::lock_guard lk(APMTX);
+    if (activeProc == e.id) {
+      activeProc = -1;
+    }
+    tray.updateWait(e.id, false);
+  } break;
   case EventType::preempt: {
     std::lock_guard lk(APMTX);
     activeProc = -1;
@@ -282,29 +389,105 @@ void View::eventInterface(Event e) {
     activeProc = e.id;
     tray.updateWait(e.id, false);
   } break;
+  case EventType::block:
+  case EventType::unblock:
+    break;
   }
 }
 
 void View::draw() {
   ClearBackground({54, 61, 75, 255});
-  DrawText("Waiting Tasks", 95, 43, 30, WHITE);
-  DrawText("Active Task", 590, 23, 30, WHITE);
+  counted(DrawText, "Waiting Tasks", 95, 43, 30, WHITE);
+  counted(DrawText, "Active Task", 590, 23, 30, WHITE);
   {
-    std::lock_guard lk(APMTX);
+    auto lk = frameProfiler().lock(APMTX);
     tray.draw(activeProc);
   }
   timeline.draw();
+  if (!status.empty()) {
+    counted(DrawText, status.c_str(), 44, 215, 20, WHITE);
+  }
+  if (lanes.empty()) {
+    return;
+  }
+  auto lk = frameProfiler().lock(eventMTX);
+  drawStats(algo, stats, 260);
+  for (PolicyLane &lane : lanes) {
+    lane.timeline->draw();
+    drawStats(lane.algo, lane.stats, lane.timeline->area().y, lane.note);
+  }
+}
+
+void View::drawStats(SchedulingAlgo algo, const PolicyStats &stats, float y,
+                     const std::string &note) {
+  float missRatio =
+      stats.released ? 100.f * stats.missed / stats.released : 0.f;
+  std::string text = algoName(algo);
+  text += note;
+  text += "  missed " + std::to_string(stats.missed) + "/" +
+          std::to_string(stats.released) + " (" +
+          std::to_string(static_cast<int>(missRatio * 10) / 10) + "." +
+          std::to_string(static_cast<int>(missRatio * 10) % 10) +
+          "%)  preempted " + std::to_string(stats.preempted) +
+          "  response " +
+          std::to_string(static_cast<long>(
+              stats.completed ? stats.responseMs / stats.completed : 0)) +
+          "ms";
+  if (stats.inversions) {
+    text += "  blocked " + std::to_string(static_cast<long>(stats.blockedMs)) +
+            "ms/" + std::to_string(stats.inversions);
+  }
+  counted(DrawText, text.c_str(), 56, y + 6, 18, WHITE);
 }
 
 void View::advanceState() {
+  auto scope = frameProfiler().measure(FrameStage::advanceState);
   {
-    std::lock_guard lk(eventMTX);
+    auto lk = frameProfiler().lock(eventMTX);
     timeline.advanceState();
+    frameProfiler().countEvents(events->size());
+    for (PolicyLane &lane : lanes) {
+      lane.timeline->advanceState();
+      frameProfiler().countEvents(lane.events->size());
+    }
+  }
+}
+
+void View::showAlgo(SchedulingAlgo newAlgo) {
+  std::lock_guard lk(eventMTX);
+  algo = newAlgo;
+}
+
+// Splits the Gantt area between the main scheduler and one lane per extra
+// policy, labelled with note after the policy name. Called before any of the
+// compared schedulers produces events.
+void View::compare(std::span<const SchedulingAlgo> algos, std::string note) {
+  std::lock_guard lk(eventMTX);
+  float laneHeight = 500.f / (algos.size() + 1);
+  timeline.setArea({44, 260, 713, laneHeight});
+  lanes.clear();
+  for (std::size_t i = 0; i < algos.size(); i++) {
+    auto laneEvents = std::make_shared<std::list<Event>>();
+    auto laneLine = std::make_unique<TimeLine>(
+        44, 260 + (i + 1) * laneHeight, 713, laneHeight, laneEvents, procPool,
+        execPath);
+    lanes.push_back({algos[i], laneEvents, std::move(laneLine), {}, note});
+  }
+}
+
+void View::laneInterface(std::size_t lane, Event e) {
+  std::lock_guard lk(eventMTX);
+  if (lane >= lanes.size()) {
+    return;
+  }
+  count(lanes[lane].stats, e);
+  if (e.type != EventType::initialize && e.type != EventType::restart) {
+    lanes[lane].events->emplace_back(e);
   }
 }
 
-void View::initTasks(std::vector<std::tuple<long, long, long>> paramVector) {
-  for (int i = 0; i < paramVector.size(); ++i) {
+void View::initTasks(std::span<const TaskParams> paramVector) {
+  for (std::size_t i = 0; i < paramVector.size(); ++i) {
     procPool->insert({procNum, {false, procColors[procNum % 5]}});
     procNum++;
   }
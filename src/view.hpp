@@ -6,6 +6,8 @@
 #include <map>
 #include <memory>
 #include <optional>
+#include <span>
+#include <string>
 #include <raylib.h>
 #include <tuple>
 #include <utility>
@@ -44,6 +46,8 @@ class TimeLine {
   std::shared_ptr<std::map<int, std::pair<bool, Color>>> procPool;
   std::shared_ptr<std::list<Event>> events;
   std::vector<TLElement> elements;
+  // Intervals a job spent ready while a lower priority one ran.
+  std::vector<TLElement> blockedElements;
   Rectangle mainRec;
   const float logsHeight = 0.08;
   Rectangle recA;
@@ -69,12 +73,27 @@ public:
            std::filesystem::path execPath);
 
   void advanceState();
+  void setArea(Rectangle area);
+  Rectangle area() const { return mainRec; }
 
   void drawTimeLine();
   void drawLogs();
   void draw();
 };
 
+// Outcome counters of one policy's run, shown in comparison mode.
+struct PolicyStats {
+  long released = 0;
+  long completed = 0;
+  long preempted = 0;
+  long missed = 0;
+  double responseMs = 0;
+  std::map<int, std::chrono::steady_clock::time_point> releasedAt;
+  long inversions = 0;
+  double blockedMs = 0;
+  std::map<int, std::chrono::steady_clock::time_point> blockedAt;
+};
+
 class View {
   float x = 0;
   float y = 0;
@@ -90,12 +109,33 @@ class View {
 
   TraySection tray;
   TimeLine timeline;
+  SchedulingAlgo algo = SchedulingAlgo::EDF;
+  PolicyStats stats;
+
+  // Extra policies run on the same task set, stacked under the main lane.
+  struct PolicyLane {
+    SchedulingAlgo algo;
+    std::shared_ptr<std::list<Event>> events;
+    std::unique_ptr<TimeLine> timeline;
+    PolicyStats stats;
+    std::string note;
+  };
+  std::vector<PolicyLane> lanes;
+  std::string status;
+
+  static void count(PolicyStats &stats, const Event &e);
+  void drawStats(SchedulingAlgo algo, const PolicyStats &stats, float y,
+                 const std::string &note = {});
 
 public:
   void eventInterface(Event);
   View(float width, float height, std::filesystem::path execPath);
   void draw();
   void advanceState();
-  void initTasks(std::vector<std::tuple<long, long, long>> paramVector);
+  void initTasks(std::span<const TaskParams> paramVector);
   void removeTasks(std::vector<int> tasksId);
+  void showAlgo(SchedulingAlgo newAlgo);
+  void showStatus(std::string text) { status = std::move(text); }
+  void compare(std::span<const SchedulingAlgo> algos, std::string note = {});
+  void laneInterface(std::size_t lane, Event e);
 };
@@ -0,0 +1,55 @@
+#include "whatif.hpp"
+#include "trace.hpp"
+#include <future>
+
+namespace {
+BranchResult runBranch(const Snapshot &base, const Transaction &branch,
+                       std::chrono::steady_clock::duration horizon) {
+  BranchResult result;
+  TraceHash hash;
+  Scheduler fork(base.algo, [&](Event e) {
+    hash.push(e);
+    switch (e.type) {
+    case EventType::initialize:
+    case EventType::restart:
+      result.released++;
+      break;
+    case EventType::complete:
+      result.completed++;
+      break;
+    case EventType::preempt:
+      result.preempted++;
+      break;
+    case EventType::missed:
+      result.missed++;
+      break;
+    default:
+      break;
+    }
+  });
+  fork.restore(base);
+  fork.commit(branch);
+  fork.runFor(horizon);
+  result.hash = hash.value();
+  result.events = hash.events();
+  return result;
+}
+} // namespace
+
+std::vector<BranchResult>
+explore(std::shared_ptr<const Snapshot> base,
+        std::span<const Transaction> branches,
+        std::chrono::steady_clock::duration horizon) {
+  std::vector<std::future<BranchResult>> running;
+  running.reserve(branches.size());
+  for (const Transaction &branch : branches) {
+    running.push_back(std::async(std::launch::async, runBranch,
+                                 std::cref(*base), std::cref(branch), horizon));
+  }
+  std::vector<BranchResult> results;
+  results.reserve(running.size());
+  for (auto &branch : running) {
+    results.push_back(branch.get());
+  }
+  return results;
+}
@@ -0,0 +1,27 @@
+// whatif.hpp - runs alternative futures of a scheduler from a snapshot
+#pragma once
+
+#include "scheduler.hpp"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+struct BranchResult {
+  std::uint64_t hash = 0;
+  std::uint64_t events = 0;
+  long released = 0;
+  long completed = 0;
+  long preempted = 0;
+  long missed = 0;
+};
+
+// Forks one scheduler per branch from base, commits the branch's changes at
+// the snapshot instant and fast-forwards it by horizon in virtual time. The
+// branches run in parallel and never touch the scheduler the snapshot came
+// from. An empty transaction gives the baseline to compare against.
+std::vector<BranchResult>
+explore(std::shared_ptr<const Snapshot> base,
+        std::span<const Transaction> branches,
+        std::chrono::steady_clock::duration horizon);